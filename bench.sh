@@ -0,0 +1,158 @@
+#!/bin/sh
+#
+# Benchmark dox11cmd verbs on a private Xvfb display, against
+# synthetic Window populations kept stacked by benchWm.
+#
+# Appends one line per (windows, verb) to $BENCH_RESULTS, tagged
+# with the commit, so runs can be compared across commits:
+#
+#    commit  date  windows  verb  runs  median_ms  min_ms
+#    calls  round_trips  bytes
+#
+# calls, round_trips & bytes (received) are dox11cmd's own --stats
+# totals, over one more run.
+#
+# Environment: BENCH_SIZES ("10 100 1000 5000"), BENCH_RUNS (20),
+# BENCH_RESULTS (bench-results.tsv).
+
+set -u
+
+LC_ALL=C
+export LC_ALL
+
+SIZES=${BENCH_SIZES:-"10 100 1000 5000"}
+RUNS=${BENCH_RUNS:-20}
+RESULTS=${BENCH_RESULTS:-bench-results.tsv}
+VERBS="list raise lower unmap map"
+
+COMMIT=$(git rev-parse --short HEAD 2>/dev/null || echo unknown)
+if [ -n "$(git status --porcelain --untracked-files=no 2>/dev/null)" ]; then
+    COMMIT="$COMMIT+"
+fi
+DATE=$(date -u +%Y-%m-%dT%H:%M:%SZ)
+
+WORK=$(mktemp -d)
+XVFB_PID=""
+WM_PID=""
+
+cleanup() {
+    [ -n "$WM_PID" ] && kill "$WM_PID" 2>/dev/null
+    [ -n "$XVFB_PID" ] && kill "$XVFB_PID" 2>/dev/null
+    wait 2>/dev/null
+    rm -rf "$WORK"
+}
+trap cleanup EXIT
+trap 'exit 1' INT TERM
+
+# Nanoseconds, wall clock.
+now() {
+    date +%s%N
+}
+
+# A private server; Xvfb picks a free display number.
+startXvfb() {
+    : > "$WORK/display"
+    Xvfb -displayfd 9 -screen 0 1920x1080x24 -nolisten tcp \
+        9>"$WORK/display" 2>"$WORK/xvfb.log" &
+    XVFB_PID=$!
+
+    for i in $(seq 100); do
+        [ -s "$WORK/display" ] && break
+        sleep 0.1
+    done
+    if [ ! -s "$WORK/display" ]; then
+        echo "bench: Xvfb did not start, see below." >&2
+        cat "$WORK/xvfb.log" >&2
+        exit 1
+    fi
+    DISPLAY=":$(head -n 1 "$WORK/display")"
+    export DISPLAY
+}
+
+startBenchWm() {
+    ./benchWm "$1" > "$WORK/wm.out" &
+    WM_PID=$!
+
+    for i in $(seq 600); do
+        grep -q ready "$WORK/wm.out" 2>/dev/null && return
+        sleep 0.1
+    done
+    echo "bench: benchWm did not get ready." >&2
+    exit 1
+}
+
+stopBenchWm() {
+    kill "$WM_PID" 2>/dev/null
+    wait "$WM_PID" 2>/dev/null
+    WM_PID=""
+}
+
+runVerb() {
+    if [ "$1" = "list" ]; then
+        ./dox11cmd list > /dev/null
+    else
+        ./dox11cmd "$1" "=$TARGET" > /dev/null
+    fi
+}
+
+# calls, round trips & bytes received, summed over the phases.
+statsVerb() {
+    if [ "$1" = "list" ]; then
+        set -- list
+    else
+        set -- "$1" "=$TARGET"
+    fi
+    ./dox11cmd --stats --color=never "$@" 2>&1 > /dev/null | awk '
+        $1 ~ /^(connect|enumerate|match|act)$/ {
+            calls += $2; roundTrips += $3; bytes += $4
+        }
+        END { printf "%d\t%d\t%d\n", calls, roundTrips, bytes }'
+}
+
+
+# Daemon & session settings of the caller don't apply here.
+unset WAYLAND_DISPLAY
+XDG_SESSION_TYPE=x11
+XDG_RUNTIME_DIR="$WORK"
+export XDG_SESSION_TYPE XDG_RUNTIME_DIR
+
+if [ ! -f "$RESULTS" ]; then
+    printf "commit\tdate\twindows\tverb\truns\tmedian_ms\tmin_ms\t" \
+        > "$RESULTS"
+    printf "calls\tround_trips\tbytes\n" >> "$RESULTS"
+fi
+
+startXvfb
+
+for SIZE in $SIZES; do
+    echo "bench: $SIZE Windows."
+    startBenchWm "$SIZE"
+    TARGET=$(printf "bench window %05d" $(( SIZE / 2 )))
+
+    # Interleave the verbs, so unmap & map alternate.
+    : > "$WORK/times"
+    for run in $(seq "$RUNS"); do
+        for VERB in $VERBS; do
+            START=$(now)
+            runVerb "$VERB"
+            echo "$VERB $(( $(now) - START ))" >> "$WORK/times"
+        done
+    done
+
+    for VERB in $VERBS; do
+        COUNTS=$(statsVerb "$VERB")
+        grep "^$VERB " "$WORK/times" | cut -d ' ' -f 2 | sort -n | awk \
+            -v prefix="$COMMIT	$DATE	$SIZE	$VERB" -v counts="$COUNTS" '
+            { ns[NR] = $1 }
+            END {
+                median = NR % 2 ? ns[(NR + 1) / 2] :
+                    (ns[NR / 2] + ns[NR / 2 + 1]) / 2
+                printf "%s\t%d\t%.3f\t%.3f\t%s\n", prefix, NR,
+                    median / 1e6, ns[1] / 1e6, counts
+            }' | tee -a "$RESULTS"
+    done
+
+    stopBenchWm
+done
+
+echo "bench: Results appended to $RESULTS."
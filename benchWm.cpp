@@ -0,0 +1,178 @@
+/**
+ * Benchmark stand-in window manager: creates COUNT titled
+ * top-level Windows on a (private, Xvfb) display, then keeps
+ * _NET_CLIENT_LIST_STACKING current as they are raised, lowered,
+ * mapped & unmapped, until killed.
+ *
+ * It does not redirect or decorate anything; dox11cmd's requests
+ * go straight to the X server, and this only mirrors the result.
+ * Prints "ready" once the first stacking list is published.
+ *
+ *    benchWm COUNT
+ */
+
+// Std C and c++.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_set>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace std;
+
+// X11.
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+
+
+/**
+ * Module globals.
+ */
+static Display* mDisplay;
+static Window mRoot;
+static unordered_set<Window> mBenchWindows;
+
+static Atom mNetClientListStacking;
+static Atom mNetSupported;
+static Atom mNetWmName;
+static Atom mNetWmPid;
+static Atom mUtf8String;
+static Atom mWmState;
+
+
+/**
+ * Module helpers.
+ */
+static Window createBenchWindow(int index) {
+    const int x = (index % 32) * 40;
+    const int y = (index / 32 % 24) * 30;
+    Window window = XCreateSimpleWindow(mDisplay, mRoot, x, y, 320, 200,
+        0, 0, 0);
+
+    char title[40];
+    snprintf(title, sizeof(title), "bench window %05d", index);
+    XStoreName(mDisplay, window, title);
+    XChangeProperty(mDisplay, window, mNetWmName, mUtf8String, 8,
+        PropModeReplace, (unsigned char*) title, strlen(title));
+
+    XClassHint classHint;
+    classHint.res_name = (char*) "bench";
+    classHint.res_class = (char*) "BenchWm";
+    XSetClassHint(mDisplay, window, &classHint);
+
+    const long pid = getpid();
+    XChangeProperty(mDisplay, window, mNetWmPid, XA_CARDINAL, 32,
+        PropModeReplace, (unsigned char*) &pid, 1);
+
+    const long wmState[2] = { NormalState, None };
+    XChangeProperty(mDisplay, window, mWmState, mWmState, 32,
+        PropModeReplace, (unsigned char*) wmState, 2);
+
+    XMapWindow(mDisplay, window);
+    return window;
+}
+
+static bool isStackingEvent(const XEvent& event) {
+    switch (event.type) {
+        case ConfigureNotify:
+        case CirculateNotify:
+        case MapNotify:
+        case UnmapNotify:
+        case DestroyNotify:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+/**
+ * Publish the bench Windows, in server stacking order (bottom-most
+ * first), as _NET_CLIENT_LIST_STACKING.
+ */
+static void publishStacking() {
+    Window rootReturn;
+    Window parentReturn;
+    Window* children = NULL;
+    unsigned int count = 0;
+    if (!XQueryTree(mDisplay, mRoot, &rootReturn, &parentReturn,
+            &children, &count)) {
+        return;
+    }
+
+    vector<long> stacking;
+    stacking.reserve(count);
+    for (unsigned int i = 0; i < count; i++) {
+        if (mBenchWindows.count(children[i])) {
+            stacking.push_back(children[i]);
+        }
+    }
+    if (children) {
+        XFree(children);
+    }
+
+    XChangeProperty(mDisplay, mRoot, mNetClientListStacking, XA_WINDOW,
+        32, PropModeReplace, (unsigned char*) stacking.data(),
+        stacking.size());
+}
+
+
+/**
+ * Module Entry.
+ */
+int main(int argc, char **argv) {
+    const int windowCount = argc > 1 ? atoi(argv[1]) : 0;
+    if (windowCount <= 0) {
+        fprintf(stderr, "Useage: benchWm COUNT\n");
+        return 1;
+    }
+
+    mDisplay = XOpenDisplay(NULL);
+    if (!mDisplay) {
+        fprintf(stderr, "benchWm: Cannot open the display.\n");
+        return 1;
+    }
+    mRoot = DefaultRootWindow(mDisplay);
+
+    mNetClientListStacking = XInternAtom(mDisplay,
+        "_NET_CLIENT_LIST_STACKING", False);
+    mNetSupported = XInternAtom(mDisplay, "_NET_SUPPORTED", False);
+    mNetWmName = XInternAtom(mDisplay, "_NET_WM_NAME", False);
+    mNetWmPid = XInternAtom(mDisplay, "_NET_WM_PID", False);
+    mUtf8String = XInternAtom(mDisplay, "UTF8_STRING", False);
+    mWmState = XInternAtom(mDisplay, "WM_STATE", False);
+
+    // Only the stacking list is offered, so dox11cmd restacks
+    // with plain X requests.
+    XChangeProperty(mDisplay, mRoot, mNetSupported, XA_ATOM, 32,
+        PropModeReplace, (unsigned char*) &mNetClientListStacking, 1);
+
+    XSelectInput(mDisplay, mRoot, SubstructureNotifyMask);
+    for (int i = 0; i < windowCount; i++) {
+        mBenchWindows.insert(createBenchWindow(i));
+    }
+
+    publishStacking();
+    XSync(mDisplay, False);
+    printf("ready\n");
+    fflush(stdout);
+
+    // Republish after each burst of stacking changes.
+    while (true) {
+        XEvent event;
+        XNextEvent(mDisplay, &event);
+        bool isStackingChanged = isStackingEvent(event);
+        while (XPending(mDisplay)) {
+            XNextEvent(mDisplay, &event);
+            isStackingChanged |= isStackingEvent(event);
+        }
+
+        if (isStackingChanged) {
+            publishStacking();
+            XFlush(mDisplay);
+        }
+    }
+}
@@ -0,0 +1,333 @@
+/**
+ * libdox11 session: owns the connection, snapshot & backend, and
+ * routes each X error to the session whose Display it came from.
+ */
+
+// Std C and c++.
+#include <mutex>
+#include <stdio.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+// X11.
+#include <X11/Xlib.h>
+#include <X11/Xproto.h>
+
+// Application.
+#include "dox11Session.h"
+#include "dox11Types.h"
+#include "outputWriter.h"
+#include "windowBackend.h"
+#include "windowMatcher.h"
+#include "windowSnapshot.h"
+#include "xDisplayHelper.h"
+#include "xStats.h"
+#include "xTrace.h"
+
+
+/**
+ * Module globals.
+ */
+
+// Xlib's error handler is one per process; it finds the session
+// by Display.
+static mutex mSessionsMutex;
+static unordered_map<Display*, Dox11Session*> mSessions;
+
+
+/**
+ * Class instantiation.
+ */
+WinInfoRange::WinInfoRange(const WinInfo* first, size_t count) {
+    mFirst = first;
+    mCount = count;
+}
+
+const WinInfo* WinInfoRange::begin() const {
+    return mFirst;
+}
+
+const WinInfo* WinInfoRange::end() const {
+    return mFirst + mCount;
+}
+
+size_t WinInfoRange::size() const {
+    return mCount;
+}
+
+
+/**
+ * Class instantiation. Connects, but reads nothing until
+ * refresh().
+ */
+Dox11Session::Dox11Session(const char* displayName,
+        const string& backendName) {
+    mDisplayHelper = new xDisplayHelper(displayName);
+    mDisplay = mDisplayHelper->getDisplay();
+    mIsErrorsQuiet = false;
+
+    if (mDisplay) {
+        XSynchronize(mDisplay, 0);
+        lock_guard<mutex> lock(mSessionsMutex);
+        mSessions[mDisplay] = this;
+        XSetErrorHandler(handleX11ErrorEvent);
+    }
+
+    mBackend = createWindowBackend(backendName, mDisplayHelper);
+    mSnapshot = new WindowSnapshot(mDisplayHelper);
+}
+
+Dox11Session::~Dox11Session() {
+    if (mDisplay) {
+        lock_guard<mutex> lock(mSessionsMutex);
+        mSessions.erase(mDisplay);
+    }
+
+    delete mSnapshot;
+    delete mBackend;
+    delete mDisplayHelper;
+}
+
+bool Dox11Session::isOpen() {
+    return mDisplay || isTraceReplaying();
+}
+
+xDisplayHelper* Dox11Session::getDisplayHelper() {
+    return mDisplayHelper;
+}
+
+Display* Dox11Session::getDisplay() {
+    return mDisplay;
+}
+
+WindowSnapshot* Dox11Session::getSnapshot() {
+    return mSnapshot;
+}
+
+WindowBackend* Dox11Session::getBackend() {
+    return mBackend;
+}
+
+bool Dox11Session::refresh() {
+    return isOpen() && mSnapshot->collect();
+}
+
+bool Dox11Session::refreshWorkspace(long workspace) {
+    return isOpen() && mSnapshot->collectWorkspace(workspace);
+}
+
+WinInfoRange Dox11Session::getWindows() {
+    const size_t count = mSnapshot->size();
+    return WinInfoRange(count ? mSnapshot->getInfo(0) : NULL, count);
+}
+
+vector<const WinInfo*> Dox11Session::getWorkspaceWindows(
+        long workspace) {
+    const vector<size_t>& indexes = mSnapshot->getWorkspaceWindows(
+        workspace);
+
+    vector<const WinInfo*> winInfos;
+    for (int i = indexes.size() - 1; i >= 0; i--) {
+        winInfos.push_back(mSnapshot->getInfo(indexes[i]));
+    }
+    return winInfos;
+}
+
+vector<const WinInfo*> Dox11Session::findWindows(
+        WindowMatcher& matcher) {
+    StatsPhase phase(STATS_MATCH);
+    const vector<size_t> matches = matcher.match(*mSnapshot);
+
+    vector<const WinInfo*> winInfos;
+    for (size_t i = 0; i < matches.size(); i++) {
+        winInfos.push_back(mSnapshot->getInfo(matches[i]));
+    }
+    return winInfos;
+}
+
+const WinInfo* Dox11Session::findWindow(WindowMatcher& matcher) {
+    StatsPhase phase(STATS_MATCH);
+    const vector<size_t> matches = matcher.match(*mSnapshot);
+    return matches.empty() ? NULL : mSnapshot->getInfo(matches[0]);
+}
+
+string_view Dox11Session::getTitle(const WinInfo& winInfoItem) {
+    return string_view(mSnapshot->getTitleArena().data() +
+        winInfoItem.titleOffset, winInfoItem.titleLength);
+}
+
+void Dox11Session::raiseWindow(Window window) {
+    mBackend->raiseWindow("raise", window);
+}
+
+/**
+ * Lower in one request, keeping the Window above the desktop
+ * (background) Window when there is one.
+ */
+void Dox11Session::lowerWindow(Window window) {
+    Window desktop = None;
+    for (size_t i = 0; i < mSnapshot->size(); i++) {
+        if (mSnapshot->getInfo(i)->desktop) {
+            desktop = mSnapshot->getInfo(i)->id;
+            break;
+        }
+    }
+    if (desktop == window) {
+        return;
+    }
+
+    if (mSnapshot->isSupported(NET_RESTACK_WINDOW)) {
+        sendRestackRequest("lower", window, desktop,
+            desktop ? Above : Below);
+        return;
+    }
+    if (desktop) {
+        mBackend->restackWindow("lower",
+            mSnapshot->getTopLevelWindow(window),
+            mSnapshot->getTopLevelWindow(desktop), Above);
+        return;
+    }
+    mBackend->lowerWindow("lower", mSnapshot->getTopLevelWindow(window));
+}
+
+void Dox11Session::mapWindow(Window window) {
+    mBackend->mapWindow("map", window);
+}
+
+void Dox11Session::unmapWindow(Window window) {
+    mBackend->unmapWindow("unmap", window);
+}
+
+/**
+ * Restack a Window relative to a sibling, through the window
+ * manager when it supports that. Else the two must be siblings
+ * for ConfigureWindow, which under a reparenting window manager
+ * only their frames are.
+ */
+void Dox11Session::restackWindow(const char* verb, Window window,
+        Window sibling, int stackMode) {
+    if (mSnapshot->isSupported(NET_RESTACK_WINDOW)) {
+        sendRestackRequest(verb, window, sibling, stackMode);
+        return;
+    }
+    mBackend->restackWindow(verb, mSnapshot->getTopLevelWindow(window),
+        mSnapshot->getTopLevelWindow(sibling), stackMode);
+}
+
+/**
+ * Move and/or resize a Window, as valueMask's CWX, CWY, CWWidth
+ * & CWHeight bits ask, through the window manager when it
+ * supports that. StaticGravity: "rect" is the Window's own
+ * position, not its frame's.
+ */
+void Dox11Session::moveResizeWindow(const char* verb, Window window,
+        unsigned int valueMask, const LayoutRect& rect) {
+    if (mSnapshot->isSupported(NET_MOVERESIZE_WINDOW)) {
+        const long data[5] = {
+            StaticGravity | (valueMask & 0xf) << 8 |
+                2 << 12, // Source: pager / tool.
+            rect.x,
+            rect.y,
+            (long) rect.w,
+            (long) rect.h
+        };
+        mBackend->sendRootMessage(verb, window,
+            mDisplayHelper->getAtom(NET_MOVERESIZE_WINDOW), data);
+        return;
+    }
+    mBackend->configureWindow(verb, window, valueMask, rect.x, rect.y,
+        rect.w, rect.h);
+}
+
+/**
+ * Ask the window manager to move a Window to a workspace
+ * (_NET_WM_DESKTOP); -1 puts it on all of them.
+ */
+void Dox11Session::moveToWorkspace(Window window, long workspace) {
+    const long data[5] = {
+        workspace,
+        2, // Source: pager / tool.
+        0,
+        0,
+        0
+    };
+    mBackend->sendRootMessage("move-ws", window,
+        mDisplayHelper->getAtom(NET_WM_DESKTOP), data);
+}
+
+/**
+ * Helper sends an EWMH _NET_RESTACK_WINDOW request.
+ */
+void Dox11Session::sendRestackRequest(const char* verb, Window window,
+        Window sibling, int stackMode) {
+    const long data[5] = {
+        2, // Source: pager / tool.
+        (long) sibling,
+        stackMode,
+        0,
+        0
+    };
+    mBackend->sendRootMessage(verb, window,
+        mDisplayHelper->getAtom(NET_RESTACK_WINDOW), data);
+}
+
+void Dox11Session::sync(vector<TrackedRequest>& failures,
+        vector<UntrackedError>& errors) {
+    mBackend->syncRequests(failures, errors);
+}
+
+void Dox11Session::sync(OutputWriter& out) {
+    mBackend->syncRequests(out);
+}
+
+void Dox11Session::setErrorsQuiet(bool isQuiet) {
+    mIsErrorsQuiet = isQuiet;
+}
+
+/**
+ * Traps X11 errors: each is left for its session's next sync(),
+ * by Window & verb if a tracked request's, else by request.
+ */
+int Dox11Session::handleX11ErrorEvent(Display* dpy, XErrorEvent* event) {
+    statsCountError(event->error_code);
+
+    Dox11Session* session = NULL;
+    {
+        lock_guard<mutex> lock(mSessionsMutex);
+        auto found = mSessions.find(dpy);
+        if (found != mSessions.end()) {
+            session = found->second;
+        }
+    }
+    if (session && session->mIsErrorsQuiet) {
+        return 0;
+    }
+
+    // A Window gone before its event selection is no error.
+    if (event->error_code == BadWindow &&
+            event->request_code == X_ChangeWindowAttributes) {
+        return 0;
+    }
+
+    if (session) {
+        if (!session->mBackend->recordError(event->serial,
+                event->error_code)) {
+            session->mBackend->recordUntrackedError(event->request_code,
+                event->resourceid, event->error_code);
+        }
+        return 0;
+    }
+
+    // Print the error message of the event.
+    char msg[MAX_ERROR_MESSAGE_LENGTH];
+    XGetErrorText(dpy, event->error_code, msg, sizeof(msg));
+
+    printf("dox11cmd: Error is %s%s%s.\n",
+        COLOR_RED, msg, COLOR_NORMAL);
+
+    return 0;
+}
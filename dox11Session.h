@@ -0,0 +1,120 @@
+#pragma once
+
+/**
+ * libdox11 session: one X connection, with its Window snapshot &
+ * action backend, for a program to query & act on Windows the
+ * way dox11cmd does, with no process or text in between.
+ *
+ *    Dox11Session session;
+ *    session.refresh();
+ *    WindowMatcher matcher("class:xterm");
+ *    for (const WinInfo* winInfoItem : session.findWindows(matcher)) {
+ *        session.raiseWindow(winInfoItem->id);
+ *    }
+ *    session.sync(failures, errors);
+ *
+ * A session belongs to one thread at a time; sessions on other
+ * threads, or displays, are independent.
+ */
+
+// Std C and c++.
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+// X11.
+#include <X11/Xlib.h>
+
+// Application.
+#include "dox11Types.h"
+#include "outputWriter.h"
+#include "windowBackend.h"
+#include "windowMatcher.h"
+#include "windowSnapshot.h"
+#include "xDisplayHelper.h"
+
+/**
+ * Snapshot entries, for a range-for. Valid until the snapshot
+ * next changes.
+ */
+class WinInfoRange {
+    public:
+        WinInfoRange(const WinInfo* first, size_t count);
+
+        const WinInfo* begin() const;
+        const WinInfo* end() const;
+        size_t size() const;
+
+    private:
+        const WinInfo* mFirst;
+        size_t mCount;
+};
+
+/**
+ * Class def.
+ */
+class Dox11Session {
+    public:
+        // NULL for $DISPLAY. "backendName" as for --backend; with
+        // a trace replaying (see xTrace.h), "replay".
+        Dox11Session(const char* displayName = NULL,
+            const string& backendName = "xlib");
+        ~Dox11Session();
+
+        // False if the display could not be opened.
+        bool isOpen();
+
+        xDisplayHelper* getDisplayHelper();
+        Display* getDisplay();       // NULL when replaying.
+        WindowSnapshot* getSnapshot();
+        WindowBackend* getBackend();
+
+        // Read the snapshot whole, or only one workspace's Windows.
+        bool refresh();
+        bool refreshWorkspace(long workspace);
+
+        // Queries: every Window in stacking order (bottom-most
+        // first), the rest top-most first, as matchers give them.
+        WinInfoRange getWindows();
+        vector<const WinInfo*> getWorkspaceWindows(long workspace);
+        vector<const WinInfo*> findWindows(WindowMatcher&);
+        const WinInfo* findWindow(WindowMatcher&);    // NULL if none.
+        string_view getTitle(const WinInfo&);
+
+        // Actions, queued, not waited for. lower keeps a Window
+        // above the desktop; it & restack go through the window
+        // manager when it supports that, else restack the
+        // Windows' frames (their ancestors that are the root's
+        // children), read once per snapshot.
+        void raiseWindow(Window);
+        void lowerWindow(Window);
+        void mapWindow(Window);
+        void unmapWindow(Window);
+        void restackWindow(const char* verb, Window, Window sibling,
+            int stackMode);
+        void moveResizeWindow(const char* verb, Window,
+            unsigned int valueMask, const LayoutRect&);
+        void moveToWorkspace(Window, long workspace);
+
+        // One wait for every action queued; those that failed, by
+        // Window & verb, and any other X error, by request.
+        void sync(vector<TrackedRequest>& failures,
+            vector<UntrackedError>& errors);
+        void sync(OutputWriter&);
+
+        // While set, X errors are the caller's to notice.
+        void setErrorsQuiet(bool);
+
+    private:
+        void sendRestackRequest(const char* verb, Window,
+            Window sibling, int stackMode);
+        static int handleX11ErrorEvent(Display*, XErrorEvent*);
+
+        xDisplayHelper* mDisplayHelper;
+        Display* mDisplay;
+        WindowSnapshot* mSnapshot;
+        WindowBackend* mBackend;
+        bool mIsErrorsQuiet;
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+/**
+ * libdox11 types: the Window table entries, screen rectangles,
+ * the list --format=bin stream & message colors, shared by the
+ * library and dox11cmd.
+ */
+
+// Std C and c++.
+#include <cstdint>
+
+// X11.
+#include <X11/Xlib.h>
+
+/**
+ * Module Types, Enums, & Defines.
+ */
+typedef struct {
+        Window id;         // id.
+        long ws;           // workspace.
+        long pid;          // owning process id, or 0.
+
+        bool sticky;       // visible on all workspaces?
+        bool dock;         // is a "dock" (panel)?
+        bool desktop;      // is the "desktop" (background)?
+        bool hidden;       // is hidden / iconized?
+
+        int x, y;          // x,y coordinates.
+        int xa, ya;        // x,y coordinates absolute.
+        unsigned int w, h; // width, height.
+
+        unsigned int titleOffset; // UTF-8 title, in the
+        unsigned int titleLength; // snapshot's title arena.
+} WinInfo;
+
+// A screen rectangle, absolute.
+typedef struct {
+        int x, y;
+        unsigned int w, h;
+} LayoutRect;
+
+// The window manager's frame around a Window (_NET_FRAME_EXTENTS).
+typedef struct {
+        long left, right, top, bottom;
+} FrameExtents;
+
+/**
+ * list --format=bin stream, native byte order: one header, then
+ * "count" fixed-size records (top-most first), then the title
+ * arena they point into, "titleArenaLength" bytes of '\0'
+ * terminated UTF-8.
+ */
+#define WIN_INFO_STREAM_MAGIC 0x31584f44 // "DOX1".
+#define WIN_INFO_STREAM_VERSION 1
+
+#define WIN_INFO_STICKY 0x01
+#define WIN_INFO_DOCK 0x02
+#define WIN_INFO_DESKTOP 0x04
+#define WIN_INFO_HIDDEN 0x08
+
+typedef struct {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t recordSize;
+        uint32_t count;
+        uint32_t titleArenaLength;
+} WinInfoStreamHeader;
+
+typedef struct {
+        uint64_t id;
+        int64_t ws;
+        int64_t pid;
+        int32_t x, y;
+        int32_t xa, ya;
+        uint32_t w, h;
+        uint32_t titleOffset;
+        uint32_t titleLength;
+        uint32_t flags;    // WIN_INFO_* bits.
+        uint32_t reserved;
+} WinInfoRecord;
+
+static_assert(sizeof(WinInfoStreamHeader) == 16, "stream layout");
+static_assert(sizeof(WinInfoRecord) == 64, "stream layout");
+
+// Library & dox11cmd messages.
+#define COLOR_RED "\033[0;31m"
+#define COLOR_GREEN "\033[1;32m"
+#define COLOR_YELLOW "\033[1;33m"
+#define COLOR_BLUE "\033[1;34m"
+#define COLOR_NORMAL "\033[0m"
+
+#define MAX_ERROR_MESSAGE_LENGTH 60
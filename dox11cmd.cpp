@@ -5,12 +5,21 @@
 
 // Std C and c++.
 #include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <poll.h>
+#include <sstream>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string>
+#include <thread>
 #include <unistd.h>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 using namespace std;
@@ -23,7 +32,19 @@ using namespace std;
 
 // Application.
 #include "dox11cmd.h"
+#include "dox11Session.h"
+#include "utf8Helper.h"
+#include "windowCapture.h"
 #include "xDisplayHelper.h"
+#include "windowDaemon.h"
+#include "windowLayout.h"
+#include "windowMatcher.h"
+#include "snapshotFile.h"
+#include "windowBackend.h"
+#include "windowRegion.h"
+#include "windowSnapshot.h"
+#include "xStats.h"
+#include "xTrace.h"
 
 
 /**
@@ -32,616 +53,1866 @@ using namespace std;
 
 // Pattern for string switch-statement.
 vector<string> mCmdListStrings {
-    "list", "raise", "lower", "map", "unmap"
+    "list", "raise", "lower", "map", "unmap", "restack", "watch", "at",
+    "snapshot", "diff", "move-ws", "move", "resize", "tile", "capture",
+    "wait"
 };
 enum M_COMMAND_STRING {
-    LIST, RAISE, LOWER, MAP, UNMAP
+    LIST, RAISE, LOWER, MAP, UNMAP, RESTACK, WATCH, AT, SNAPSHOT, DIFF,
+    MOVE_WS, MOVE, RESIZE, TILE, CAPTURE, WAIT
 };
 
-string mCmdString = "";
-string mWindow = "";
-string mAltWindow = "";
+// Per thread: each --display=LIST worker has its own connection.
+thread_local Dox11Session* mSession = NULL;
 
-xDisplayHelper* mDisplayHelper;
-Display* mDisplay;
-int mX11LastErrorCode = 0;
+// The session's parts, as the verbs use them.
+thread_local xDisplayHelper* mDisplayHelper;
+thread_local Display* mDisplay;
+thread_local WindowSnapshot* mSnapshot;
+
+// --backend=NAME; set before any worker starts.
+string mBackendName = "xlib";
+thread_local WindowRegionIndex mRegionIndex;
+thread_local WindowCapture* mCapture = NULL;
+
+// Exit status of a verb that has one (wait).
+thread_local int mCommandStatus = 0;
 
 
 /**
  * Module Entry.
  */
 int main(int argc, char **argv) {
-    // String, and guard the inputs.
-    if (argc > 1) {
-        mCmdString = string(argv[1]);
-        if (argc > 2) {
-            mWindow = string(argv[2]);
-            if (argc > 3) {
-                mAltWindow = string(argv[3]);
+    OutputWriter out(STDOUT_FILENO);
+
+    // Options lead, then the MODE or VERB.
+    vector<string> args(argv + 1, argv + argc);
+    bool isStats = false;
+    bool isBackendChosen = false;
+    string displayList;
+    string recordPath;
+    string replayPath;
+    long latencyMilliseconds = 0;
+    for (size_t i = 0; i < args.size() &&
+            args[i].compare(0, 2, "--") == 0;) {
+        if (args[i] == "--stats") {
+            isStats = true;
+            args.erase(args.begin() + i);
+        } else if (args[i].compare(0, 10, "--display=") == 0) {
+            displayList = args[i].substr(10);
+            args.erase(args.begin() + i);
+        } else if (args[i].compare(0, 10, "--backend=") == 0) {
+            mBackendName = args[i].substr(10);
+            isBackendChosen = true;
+            args.erase(args.begin() + i);
+        } else if (args[i].compare(0, 9, "--record=") == 0) {
+            recordPath = args[i].substr(9);
+            args.erase(args.begin() + i);
+        } else if (args[i].compare(0, 9, "--replay=") == 0) {
+            replayPath = args[i].substr(9);
+            args.erase(args.begin() + i);
+        } else if (args[i].compare(0, 10, "--latency=") == 0) {
+            latencyMilliseconds = atol(args[i].c_str() + 10);
+            args.erase(args.begin() + i);
+        } else {
+            i++;
+        }
+    }
+    if (!out.applyOptions(args)) {
+        out.flush();
+        exit(1);
+    }
+    if (!isWindowBackendName(mBackendName)) {
+        out << COLOR_RED << "\ndox11cmd: BACKEND must be xlib or xcb." <<
+            COLOR_NORMAL << "\n";
+        out.flush();
+        exit(1);
+    }
+    const bool isDaemon = !args.empty() && args[0] == "--daemon";
+    const bool isBatch = !args.empty() && args[0] == "--batch";
+    const bool isWatch = !args.empty() && args[0] == "watch";
+    const bool isWait = !args.empty() && args[0] == "wait";
+    const bool isTraced = !recordPath.empty() || !replayPath.empty();
+
+    // A trace is one run's waits, in order, on one display.
+    if (!recordPath.empty() && !replayPath.empty()) {
+        out << COLOR_RED << "\ndox11cmd: --record & --replay don't mix." <<
+            COLOR_NORMAL << "\n";
+        out.flush();
+        exit(1);
+    }
+    if (isTraced && (isDaemon || isWatch || isWait ||
+            displayList.find(',') != string::npos)) {
+        out << COLOR_RED << "\ndox11cmd: --record & --replay take one "
+            "display, and no --daemon, watch or wait." << COLOR_NORMAL <<
+            "\n";
+        out.flush();
+        exit(1);
+    }
+
+    // diff reads files only; no X, nor daemon.
+    if (!args.empty() && args[0] == "diff") {
+        const int status = doDiffSnapshots(vector<string>(args.begin() + 1,
+            args.end()), out);
+        out.flush();
+        return status;
+    }
+
+    // A daemon has its own working directory: make --out
+    // absolute, and give capture --all's default, ".", as ours.
+    if (!args.empty() && (args[0] == "snapshot" ||
+            args[0] == "capture")) {
+        char* directory = getcwd(NULL, 0);
+        bool isOut = false;
+        for (size_t i = 1; i + 1 < args.size(); i++) {
+            if (args[i] == "--out") {
+                if (directory && args[i + 1][0] != '/') {
+                    args[i + 1] = string(directory) + "/" + args[i + 1];
+                }
+                isOut = true;
+                break;
             }
         }
+        if (!isOut && directory && args[0] == "capture" &&
+                find(args.begin() + 1, args.end(), "--all") !=
+                    args.end()) {
+            args.insert(args.begin() + 1, { "--out", directory });
+        }
+        free(directory);
+    }
+
+    // One display is just $DISPLAY; several get a worker each.
+    if (!displayList.empty()) {
+        const vector<string> displayNames = getDisplayNames(displayList);
+        if (displayNames.empty()) {
+            out << COLOR_RED << "\ndox11cmd: No display matches " <<
+                displayList << "." << COLOR_NORMAL << "\n";
+            out.flush();
+            exit(1);
+        }
+
+        if (displayNames.size() == 1) {
+            setenv("DISPLAY", displayNames[0].c_str(), 1);
+        } else if (isDaemon || isBatch || isWatch || isWait) {
+            out << COLOR_RED << "\ndox11cmd: --daemon, --batch, watch & "
+                "wait take a single display." << COLOR_NORMAL << "\n";
+            out.flush();
+            exit(1);
+        } else {
+            return doMultiDisplayCommand(displayNames, args, isStats,
+                out);
+        }
+    }
+
+    // Let a resident daemon serve the verb, if one is running.
+    // Its output is not this terminal, so pass on the options.
+    // --stats measures this process, and --backend & a trace ask
+    // for this process's requests, so none asks a daemon. watch
+    // & wait block on their own events.
+    if (isStats) {
+        statsEnable();
+    }
+    if (!isStats && !isBackendChosen && !isTraced && !isDaemon &&
+            !isBatch && !isWatch && !isWait) {
+        vector<string> requestArgs = out.getOptionArgs();
+        requestArgs.insert(requestArgs.end(), args.begin(), args.end());
+        if (doDaemonRequest(requestArgs, out)) {
+            return 0;
+        }
+    }
+
+    // Batch input, from FILE or stdin.
+    ifstream batchFile;
+    if (isBatch && args.size() > 1 && args[1] != "-") {
+        batchFile.open(args[1]);
+        if (!batchFile) {
+            out << COLOR_RED << "\ndox11cmd: Cannot open batch file " <<
+                args[1] << "." << COLOR_NORMAL << "\n";
+            out.flush();
+            exit(1);
+        }
+    }
+
+    // A replay stands in for the X server, before any connection.
+    if (!replayPath.empty()) {
+        if (!traceReplay(replayPath, latencyMilliseconds, out)) {
+            out.flush();
+            exit(1);
+        }
+        mBackendName = "replay";
     }
 
     // Check for Wayland as error.
     const bool isWaylandPresent = getenv("WAYLAND_DISPLAY") &&
-        getenv("WAYLAND_DISPLAY") [0];
+        getenv("WAYLAND_DISPLAY") [0] && !isTraceReplaying();
     if (isWaylandPresent) {
-        cout << COLOR_YELLOW << "\ndox11cmd: Wayland desktop is detected."
-            << COLOR_NORMAL << endl;
+        out << COLOR_YELLOW << "\ndox11cmd: Wayland desktop is detected."
+            << COLOR_NORMAL << "\n";
     }
 
     // X11 Initialization.
-    mDisplayHelper = new xDisplayHelper();
-    mDisplay = mDisplayHelper->getDisplay();
-    if (!mDisplay) {
-        cout << COLOR_RED << "\ndox11cmd: X11 Does not seem to be "
-            "available." << COLOR_NORMAL << endl;
+    openSession(NULL);
+    if (!mSession->isOpen()) {
+        out << COLOR_RED << "\ndox11cmd: X11 Does not seem to be "
+            "available." << COLOR_NORMAL << "\n";
+        out.flush();
         exit(1);
     }
 
-    XSynchronize(mDisplay, 0);
-    XSetErrorHandler(handleX11ErrorEvent);
+    if (!recordPath.empty()) {
+        Atom atoms[X_ATOM_COUNT];
+        for (int i = 0; i < X_ATOM_COUNT; i++) {
+            atoms[i] = mDisplayHelper->getAtom((X_ATOM) i);
+        }
+        if (!traceRecord(recordPath, mDisplayHelper->getRoot(),
+                mDisplayHelper->getScreenWidth(),
+                mDisplayHelper->getScreenHeight(), atoms, X_ATOM_COUNT,
+                out)) {
+            out.flush();
+            exit(1);
+        }
+    }
+
+    // One enumeration, shared by all verbs & matchers. A list of
+    // one workspace needs only its Windows.
+    statsSetPhase(STATS_ENUMERATE);
+    long workspace = 0;
+    if (getListWorkspace(args, &workspace)) {
+        mSession->refreshWorkspace(workspace);
+    } else {
+        mSession->refresh();
+    }
+
+    statsSetPhase(STATS_ACT);
+
+    int result = 0;
+    if (isDaemon) {
+        out.flush();
+        WindowDaemon daemon(mDisplayHelper, mSnapshot);
+        result = daemon.run() ? 0 : 1;
+    } else if (isBatch) {
+        doBatch(batchFile.is_open() ? batchFile : cin, out);
+    } else {
+        doCommand(args, out);
+        result = mCommandStatus;
+    }
+
+    // Let every action land, and any error arrive and be reported
+    // by Window, rather than at XCloseDisplay. Batch & daemon
+    // have already.
+    syncRequests(out);
+    out.flush();
+    traceFinish();
+
+    if (isStats) {
+        OutputWriter statsOut(STDERR_FILENO);
+        statsWrite(statsOut, mDisplay);
+    }
+
+    delete mCapture;
+    delete mSession;
+    return result;
+}
+
+/**
+ * --display=LIST: connect to, enumerate & act on every display
+ * concurrently, one worker thread each. A list is merged into one
+ * table tagged by display; other verbs' output is shown per
+ * display, in LIST order.
+ */
+int doMultiDisplayCommand(const vector<string>& displayNames,
+        const vector<string>& commandArgs, bool isStats,
+        OutputWriter& out) {
+    vector<string> args = commandArgs;
+    const string cmdString = args.size() > 0 ? args[0] : "";
+    bool isList = cmdString == "list";
+
+    if (!isList && find(mCmdListStrings.begin(), mCmdListStrings.end(),
+            cmdString) == mCmdListStrings.end()) {
+        out << COLOR_YELLOW << "\ndox11cmd: That\'s not a valid VERB." <<
+            COLOR_NORMAL << "\n";
+        doDisplayUseage(out);
+        args = { "list" };
+        isList = true;
+    }
+
+    long workspace = ALL_WORKSPACES;
+    if (isList && args.size() > 1 && !getListWorkspace(args, &workspace)) {
+        out << COLOR_RED << "\ndox11cmd: list takes --ws N." <<
+            COLOR_NORMAL << "\n";
+        out.flush();
+        return 1;
+    }
+
+    // Xlib must lock, with more than one thread about.
+    XInitThreads();
+
+    // One snapshot file each: FILE.DISPLAY.
+    const bool isSnapshot = cmdString == "snapshot" && args.size() > 2;
+
+    vector<DisplayContext> contexts(displayNames.size());
+    for (size_t i = 0; i < contexts.size(); i++) {
+        vector<string> optionArgs = out.getOptionArgs();
+        contexts[i].name = displayNames[i];
+        contexts[i].args = args;
+        if (isSnapshot) {
+            contexts[i].args[2] += "." + displayNames[i];
+        }
+        contexts[i].session = NULL;
+        contexts[i].snapshot = NULL;
+        contexts[i].out = new OutputWriter(-1);
+        contexts[i].out->applyOptions(optionArgs);
+        contexts[i].statsOut = new OutputWriter(-1);
+    }
+
+    vector<thread> workers;
+    for (size_t i = 0; i < contexts.size(); i++) {
+        workers.push_back(thread(doDisplayWorker, &contexts[i],
+            isStats));
+    }
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+
+    // Connect failures to stderr, out of the way of a list.
+    OutputWriter errorOut(STDERR_FILENO);
+    int result = 0;
+    for (size_t i = 0; i < contexts.size(); i++) {
+        if (!contexts[i].snapshot) {
+            errorOut << COLOR_RED << "dox11cmd: Cannot open display " <<
+                contexts[i].name << "." << COLOR_NORMAL << "\n";
+            result = 1;
+        }
+    }
+    errorOut.flush();
+
+    if (isList) {
+        size_t rowCount = 0;
+        writeListHeader(out, true);
+        for (size_t i = 0; i < contexts.size(); i++) {
+            if (contexts[i].snapshot) {
+                mSnapshot = contexts[i].snapshot;
+                writeListRows(out, contexts[i].name.c_str(), workspace,
+                    &rowCount);
+            }
+        }
+        writeListFooter(out);
+        mSnapshot = NULL;
+    } else {
+        for (size_t i = 0; i < contexts.size(); i++) {
+            if (!contexts[i].out->getBuffer().empty()) {
+                out << COLOR_BLUE << "\ndox11cmd: Display " <<
+                    contexts[i].name << COLOR_NORMAL << "\n";
+                out << string_view(contexts[i].out->getBuffer());
+            }
+        }
+    }
+    out.flush();
+
+    if (isStats) {
+        OutputWriter statsOut(STDERR_FILENO);
+        for (size_t i = 0; i < contexts.size(); i++) {
+            statsOut << COLOR_BLUE << "\ndox11cmd: Display " <<
+                contexts[i].name << COLOR_NORMAL << "\n";
+            statsOut << string_view(contexts[i].statsOut->getBuffer());
+        }
+    }
+
+    for (size_t i = 0; i < contexts.size(); i++) {
+        delete contexts[i].out;
+        delete contexts[i].statsOut;
+        delete contexts[i].session;
+    }
+    return result;
+}
+
+/**
+ * One display's worker: its own connection & snapshot, in this
+ * thread's globals. A list is left for main to merge.
+ */
+void doDisplayWorker(DisplayContext* context, bool isStats) {
+    const vector<string>& args = context->args;
+    if (isStats) {
+        statsEnable();
+    }
+
+    openSession(context->name.c_str());
+    context->session = mSession;
+    if (!mSession->isOpen()) {
+        return;
+    }
+
+    statsSetPhase(STATS_ENUMERATE);
+    long workspace = 0;
+    if (getListWorkspace(args, &workspace)) {
+        mSession->refreshWorkspace(workspace);
+    } else {
+        mSession->refresh();
+    }
+    context->snapshot = mSnapshot;
+
+    statsSetPhase(STATS_ACT);
+    if (args[0] != "list") {
+        doCommand(args, *context->out);
+    }
+
+    syncRequests(*context->out);
+    if (isStats) {
+        statsWrite(*context->statsOut, mDisplay);
+    }
+
+    delete mCapture;
+    mCapture = NULL;
+}
+
+/**
+ * Execute one users command against the current snapshot.
+ */
+void doCommand(const vector<string>& commandArgs, OutputWriter& out) {
+    vector<string> args = commandArgs;
+    if (!out.applyOptions(args)) {
+        return;
+    }
+
+    // String, and guard the inputs. --all, before the WINDOW,
+    // acts on every match rather than the best one.
+    const string cmdString = args.size() > 0 ? args[0] : "";
+    const bool isAll = args.size() > 1 && args[1] == "--all";
+    const size_t windowIndex = isAll ? 2 : 1;
+    const string window = args.size() > windowIndex ? args[windowIndex] :
+        "";
 
-    // Execute users command.
     switch (distance(mCmdListStrings.begin(),
             find(mCmdListStrings.begin(), mCmdListStrings.end(),
-        mCmdString))) {
+        cmdString))) {
         case LIST:
-            doListStackedWindowNames();
+            doListStackedWindowNames(vector<string>(args.begin() + 1,
+                args.end()), out);
             break;
 
         case RAISE:
-            doRaiseWindow(mWindow);
+            doRaiseWindow(window, isAll, out);
             break;
 
         case LOWER:
-            doLowerWindow(mWindow);
+            doLowerWindow(window, isAll, out);
             break;
 
         case MAP:
-            doMapWindow(mWindow);
+            doMapWindow(window, isAll, out);
             break;
 
         case UNMAP:
-            doUnmapWindow(mWindow);
+            doUnmapWindow(window, isAll, out);
+            break;
+
+        case RESTACK:
+            doRestackWindows(vector<string>(args.begin() + 1,
+                args.end()), out);
+            break;
+
+        case WATCH:
+            doWatchWindows(out);
+            break;
+
+        case AT:
+            doWindowAt(vector<string>(args.begin() + 1, args.end()), out);
+            break;
+
+        case SNAPSHOT:
+            doSnapshot(vector<string>(args.begin() + 1, args.end()), out);
+            break;
+
+        case DIFF:
+            doDiffSnapshots(vector<string>(args.begin() + 1, args.end()),
+                out);
+            break;
+
+        case MOVE_WS:
+            doMoveWindowsToWorkspace(vector<string>(args.begin() + 1,
+                args.end()), out);
+            break;
+
+        case MOVE:
+        case RESIZE:
+            doMoveResizeWindows(cmdString == "move", vector<string>(
+                args.begin() + 1, args.end()), out);
+            break;
+
+        case TILE:
+            doTileWindows(vector<string>(args.begin() + 1, args.end()),
+                out);
+            break;
+
+        case CAPTURE:
+            doCaptureWindows(vector<string>(args.begin() + 1,
+                args.end()), out);
+            break;
+
+        case WAIT:
+            doWaitForWindow(vector<string>(args.begin() + 1, args.end()),
+                out);
             break;
 
         default:
-            cout << COLOR_YELLOW <<
+            out << COLOR_YELLOW <<
                 "\ndox11cmd: That\'s not a valid VERB." <<
-                COLOR_NORMAL << endl;
-            doDisplayUseage();
-            doListStackedWindowNames();
+                COLOR_NORMAL << "\n";
+            doDisplayUseage(out);
+            doListStackedWindowNames({}, out);
     }
-
-    XCloseDisplay(mDisplay);
 }
 
 /**
- * Display useage (All Supported Commands).
+ * Batch mode: execute verb lines, one per line, against one
+ * connection & snapshot. Xlib buffers every action until a
+ * "sync" line or the end of input.
  */
-void doDisplayUseage() {
-    cout << COLOR_BLUE <<
-        "\nUseage: dox11cmd VERB [WINDOW]" <<
-        COLOR_NORMAL << endl << endl;
-
-    cout << COLOR_GREEN << "   VERBs are:" <<
-        COLOR_NORMAL << endl << endl;
-
-    cout << "      list" << endl;
-    cout << "      raise WINDOW" << endl;
-    cout << "      lower WINDOW" << endl;
-    cout << "      map WINDOW" << endl;
-    cout << "      unmap WINDOW" << endl;
-    cout << endl;
-
-    cout << COLOR_GREEN << "   WINDOWs are:" << COLOR_NORMAL <<
-        endl << endl << "      Requested by a portion of their "
-        "TitleBar Name." << endl;
-}
-
-/**
- * Supported Commands - list.
- */
-void doListStackedWindowNames() {
-    cout << COLOR_BLUE << "\nWindows in Stacked Order "
-        "above Desktop:" << COLOR_NORMAL << endl;
-
-    cout << COLOR_GREEN << "\n---window---  Titlebar Name"
-        "                             WS   "
-        "---Position-- -----Size----  Attributes" <<
-        COLOR_NORMAL << endl;
-
-    Window* stackedWins;
-    int numberOfStackedWins =
-        getX11StackedWindowsList(&stackedWins);
-
-    for (int i = numberOfStackedWins - 1; i >= 0; i--) {
-        // Get window attributes.
-        XWindowAttributes windowAttributes;
-        windowAttributes.map_state = -1;
-        windowAttributes.width = -1;
-        windowAttributes.height = -1;
-        windowAttributes.x = -1;
-        windowAttributes.y = -1;
-
-        XGetWindowAttributes(mDisplay, stackedWins[i],
-            &windowAttributes);
-
-        // Get window coordinates.
-        int xCoord = -1;
-        int yCoord = -1;
-        Window child_return = None;
-
-        XTranslateCoordinates(mDisplay, stackedWins[i],
-            DefaultRootWindow(mDisplay), 0, 0, &xCoord,
-            &yCoord, &child_return);
-
-        // Get window title.
-        // Create a formatted title (name) c-string with a hard length,
-        // replacing unprintables with SPACE, padding right with SPACE,
-        // and preserving null terminator.
-        char outputTitle[MAX_TITLE_STRING_LENGTH + 1];
-        int outP = 0;
-
-        XTextProperty titleBarName;
-        if (XGetWMName(mDisplay, stackedWins[i], &titleBarName) != 0) {
-            const char* nameP = (char*) titleBarName.value;
-            const int nameL = strlen(nameP);
-            for (; outP < nameL && outP < MAX_TITLE_STRING_LENGTH; outP++) {
-                outputTitle[outP] = isprint(*(nameP + outP)) ?
-                    *(nameP + outP) : ' ';
-            }
-            XFree(titleBarName.value);
-        }
+void doBatch(istream& in, OutputWriter& out) {
+    const char* BLANKS = " \t\r";
 
-        for (; outP < MAX_TITLE_STRING_LENGTH; outP++) {
-            outputTitle[outP] = ' ';
+    string line;
+    int lineNumber = 0;
+    while (getline(in, line)) {
+        lineNumber++;
+
+        // Skip blank lines & comments.
+        const size_t verbStart = line.find_first_not_of(BLANKS);
+        if (verbStart == string::npos || line[verbStart] == '#') {
+            continue;
         }
-        outputTitle[outP] = '\0';
 
+        // VERB, then the rest of the line is the WINDOW.
+        const size_t verbEnd = line.find_first_of(BLANKS, verbStart);
+        const string verb = line.substr(verbStart, verbEnd - verbStart);
 
-        // Create a WinInfo struct.
-        WinInfo* winInfoItem = (WinInfo*)
-            malloc(sizeof(WinInfo));
+        string window = "";
+        const size_t windowStart = line.find_first_not_of(BLANKS,
+            verbEnd);
+        if (verbEnd != string::npos && windowStart != string::npos) {
+            const size_t windowEnd = line.find_last_not_of(BLANKS);
+            window = line.substr(windowStart, windowEnd - windowStart + 1);
+        }
 
-        winInfoItem->id = stackedWins[i];
-        winInfoItem->ws = getWindowWorkspace(stackedWins[i]);
+        if (verb == "sync") {
+            syncRequests(out);
+            continue;
+        }
+        if (verb == "refresh") {
+            syncRequests(out);
+            StatsPhase phase(STATS_ENUMERATE);
+            mSnapshot->collect();
+            continue;
+        }
 
-        winInfoItem->sticky = isWindow_Sticky(winInfoItem->ws,
-            winInfoItem);
-        winInfoItem->dock = isWindow_Dock(winInfoItem);
-        winInfoItem->hidden = isWindow_Hidden(stackedWins[i],
-            windowAttributes.map_state);
+        if (find(mCmdListStrings.begin(), mCmdListStrings.end(), verb) ==
+                mCmdListStrings.end()) {
+            out << COLOR_YELLOW << "dox11cmd: Line " << lineNumber <<
+                ": That\'s not a valid VERB." << COLOR_NORMAL << "\n";
+            continue;
+        }
 
-        winInfoItem->w  = windowAttributes.width;
-        winInfoItem->h  = windowAttributes.height;
+        // restack takes several WINDOWs, at X Y, blank separated.
+        vector<string> args { verb };
+        if (window.compare(0, 5, "--all") == 0 &&
+                window.find_first_not_of(BLANKS, 5) != 5) {
+            args.push_back("--all");
+            const size_t allEnd = window.find_first_not_of(BLANKS, 5);
+            window = allEnd == string::npos ? "" : window.substr(allEnd);
+        }
+        if (verb == "restack" || verb == "at" || verb == "list") {
+            istringstream windows(window);
+            string name;
+            while (windows >> name) {
+                args.push_back(name);
+            }
+        } else if (verb == "capture" || verb == "wait") {
+            // Options, then the rest is the WINDOW.
+            size_t wordStart = window.empty() ? string::npos : 0;
+            bool isValue = false;
+            while (wordStart != string::npos &&
+                    (isValue || window.compare(wordStart, 2, "--") == 0)) {
+                const size_t wordEnd = window.find_first_of(BLANKS,
+                    wordStart);
+                const string word = window.substr(wordStart,
+                    wordEnd - wordStart);
+                args.push_back(word);
+                isValue = !isValue && (word == "--out" ||
+                    word == "--timeout");
+                wordStart = window.find_first_not_of(BLANKS, wordEnd);
+            }
+            string name = wordStart == string::npos ? "" :
+                window.substr(wordStart);
+
+            // wait's --timeout N may follow the WINDOW, too.
+            vector<string> trailing;
+            const size_t valueStart = name.find_last_of(BLANKS);
+            if (verb == "wait" && valueStart != string::npos) {
+                const size_t optionEnd = name.find_last_not_of(BLANKS,
+                    valueStart) + 1;
+                const size_t optionStart = name.find_last_of(BLANKS,
+                    optionEnd - 1) + 1;
+                if (name.compare(optionStart, optionEnd - optionStart,
+                        "--timeout") == 0) {
+                    trailing = { "--timeout", name.substr(valueStart + 1) };
+                    name.erase(optionStart);
+                    name.erase(name.find_last_not_of(BLANKS) + 1);
+                }
+            }
+            if (!name.empty()) {
+                args.push_back(name);
+            }
+            args.insert(args.end(), trailing.begin(), trailing.end());
+        } else if (verb == "move-ws" || verb == "tile" ||
+                verb == "move" || verb == "resize") {
+            // Leading words, then the rest is the WINDOW.
+            size_t wordCount = verb == "move" || verb == "resize" ? 2 : 1;
+            size_t wordStart = 0;
+            while (wordCount-- > 0 && wordStart != string::npos) {
+                const size_t wordEnd = window.find_first_of(BLANKS,
+                    wordStart);
+                args.push_back(window.substr(wordStart,
+                    wordEnd - wordStart));
+                wordStart = window.find_first_not_of(BLANKS, wordEnd);
+            }
+            if (wordStart != string::npos) {
+                args.push_back(window.substr(wordStart));
+            }
+        } else {
+            args.push_back(window);
+        }
 
-        winInfoItem->x  = windowAttributes.x;
-        winInfoItem->y  = windowAttributes.y;
+        doCommand(args, out);
+    }
 
-        winInfoItem->xa = xCoord - winInfoItem->x;
-        winInfoItem->ya = yCoord - winInfoItem->y;
+    syncRequests(out);
+}
 
-        // Log a WinInfo struct.
-        fprintf(stdout, "[0x%08lx]  %s  %2li  "
-            " %5d , %-5d %5d x %-5d  %s%s%s\n",
-            winInfoItem->id, outputTitle,
-            winInfoItem->ws,
-            winInfoItem->xa, winInfoItem->ya,
-            winInfoItem->w, winInfoItem->h,
-            winInfoItem->dock ? "dock " : "",
-            winInfoItem->sticky ? "sticky " : "",
-            winInfoItem->hidden ? "hidden" : "");
-    }
+/**
+ * Display useage (All Supported Commands).
+ */
+void doDisplayUseage(OutputWriter& out) {
+    out << COLOR_BLUE <<
+        "\nUseage: dox11cmd [OPTION]... VERB [WINDOW]" <<
+        COLOR_NORMAL << "\n\n";
+
+    out << COLOR_GREEN << "   VERBs are:" <<
+        COLOR_NORMAL << "\n\n";
+
+    out << "      list [--ws N]   (only Windows on workspace N)\n";
+    out << "      raise [--all] WINDOW\n";
+    out << "      lower [--all] WINDOW\n";
+    out << "      map [--all] WINDOW\n";
+    out << "      unmap [--all] WINDOW\n";
+    out << "      restack WINDOW WINDOW ...   (top-most first)\n";
+    out << "      watch\n";
+    out << "      at X Y   (the top-most Window at a point)\n";
+    out << "      snapshot --out FILE   (list --format=bin, to FILE)\n";
+    out << "      diff FILE FILE   (as watch records)\n";
+    out << "      move-ws N WINDOW   (every match, to workspace N)\n";
+    out << "      move [--all] X Y WINDOW\n";
+    out << "      resize [--all] W H WINDOW\n";
+    out << "      tile grid|columns|master WINDOW   (every match)\n";
+    out << "      capture [--all] [--rgba] [--out PATH] [WINDOW]"
+        "   (PPM)\n";
+    out << "      wait [--mapped|--gone|--title-changes] WINDOW"
+        " [--timeout N]\n\n";
+
+    out << COLOR_GREEN << "   WINDOWs are:" << COLOR_NORMAL <<
+        "\n\n      Requested by a portion of their "
+        "TitleBar Name, or by:\n\n";
+
+    out << "      =NAME  ^NAME  sub:NAME  i:NAME  glob:PATTERN"
+        "  re:PATTERN\n";
+    out << "      class:NAME  pid:N  id:N  ws:N\n\n";
+
+    out << COLOR_GREEN << "   MODEs are:" <<
+        COLOR_NORMAL << "\n\n";
+
+    out << "      --daemon\n";
+    out << "      --batch [FILE]   (VERB lines, plus sync & refresh)\n\n";
+
+    out << COLOR_GREEN << "   OPTIONs, before the MODE or VERB, are:" <<
+        COLOR_NORMAL << "\n\n";
+
+    out << "      --format=text|tsv|json|bin   (list output)\n";
+    out << "      --stats   (X calls, round trips, bytes & time, on exit)\n";
+    out << "      --display=LIST   (names or globs, comma separated)\n";
+    out << "      --backend=xlib|xcb   (X library for actions)\n";
+    out << "      --record=FILE   (X replies waited for, to FILE)\n";
+    out << "      --replay=FILE [--latency=MS]   (no X server)\n";
+    out << "      --color=auto|always|never\n";
 }
 
 /**
- * Supported Commands - raise.
+ * Supported Commands - list, in the --format asked for; with
+ * --ws N, the Windows on workspace N only.
  */
-void doRaiseWindow(string windowString) {
-    Window window = getWindowWithBestName(windowString);
-    if (!window) {
-        cout << COLOR_RED << "\ndox11cmd: Cannot find a Window "
-            "by that name." << COLOR_NORMAL << endl;
+void doListStackedWindowNames(const vector<string>& options,
+        OutputWriter& out) {
+    vector<string> args { "list" };
+    args.insert(args.end(), options.begin(), options.end());
+
+    long workspace = ALL_WORKSPACES;
+    if (!options.empty() && !getListWorkspace(args, &workspace)) {
+        out << COLOR_RED << "\ndox11cmd: list takes --ws N." <<
+            COLOR_NORMAL << "\n";
         return;
     }
 
-    if(!XRaiseWindow(mDisplay, window)) {
-        cout << COLOR_RED << "dox11cmd: Error encountered trying to "
-            "raise the Window ?? FATAL." << COLOR_NORMAL << endl;
-        return;
-    }
+    size_t rowCount = 0;
+    writeListHeader(out, false);
+    writeListRows(out, NULL, workspace, &rowCount);
+    writeListFooter(out);
 }
 
 /**
- * Supported Commands - lower.
+ * Helper finds the workspace of a "list --ws N" command. False
+ * for any other command.
  */
-void doLowerWindow(string windowString) {
-    Window window = getWindowWithBestName(windowString);
-    if (!window) {
-        cout << COLOR_RED << "\ndox11cmd: Cannot find a Window "
-            "by that name." << COLOR_NORMAL << endl;
-        return;
+bool getListWorkspace(const vector<string>& args, long* workspace) {
+    if (args.size() != 3 || args[0] != "list" || args[1] != "--ws" ||
+            args[2].empty()) {
+        return false;
     }
 
-    // Lower target, by raising all other windows above it.
-    // Ignore desktop @ [0].
-    Window* stackedWins;
-    int numberOfStackedWins = getX11StackedWindowsList(&stackedWins);
-    for (int i = 1; i < numberOfStackedWins; i++) {
-        if (window == stackedWins[i]) {
-            continue;
-        }
-        if (!XRaiseWindow(mDisplay, stackedWins[i])) {
-            cout << COLOR_RED << "dox11cmd: Error trying to "
-                "lower the Window." << COLOR_NORMAL << endl;
-            return;
-        }
+    char* end = NULL;
+    *workspace = strtol(args[2].c_str(), &end, 10);
+    return *end == '\0';
+}
+
+/**
+ * Helper writes what precedes the rows. A tagged list has a
+ * leading display column (several displays, merged).
+ */
+void writeListHeader(OutputWriter& out, bool isTagged) {
+    switch (out.getFormat()) {
+        case FORMAT_TSV:
+            out << (isTagged ? "display\t" : "") <<
+                "id\ttitle\tws\tpid\tx\ty\tw\th\t"
+                "desktop\tdock\tsticky\thidden\tvisible\tvisible_pct\n";
+            break;
+
+        case FORMAT_JSON:
+            out << '[';
+            break;
+
+        case FORMAT_BIN:
+            break;
+
+        default:
+            out << COLOR_BLUE << "\nWindows in Stacked Order "
+                "above Desktop:" << COLOR_NORMAL << "\n";
+
+            out << COLOR_GREEN << "\n" <<
+                (isTagged ? "display     " : "") <<
+                "---window---  Titlebar Name"
+                "                             WS   "
+                "---Position-- -----Size----  Vis%  Attributes" <<
+                COLOR_NORMAL << "\n";
     }
 }
 
 /**
- * Supported Commands - map.
+ * Helper writes the current snapshot's Windows, top-most first,
+ * tagged with "display" unless NULL, and only those on one
+ * workspace unless ALL_WORKSPACES. rowCount runs on across calls,
+ * for the JSON separators.
  */
-void doMapWindow(string windowString) {
-    Window window = getWindowWithBestName(windowString);
-    if (!window) {
-        cout << COLOR_RED << "\ndox11cmd: Cannot find a Window "
-            "by that name." << COLOR_NORMAL << endl;
+void writeListRows(OutputWriter& out, const char* display,
+        long workspace, size_t* rowCount) {
+    // Binary: one self-contained stream per snapshot.
+    if (out.getFormat() == FORMAT_BIN) {
+        writeListBin(out, workspace);
         return;
     }
 
-    if(!XMapWindow(mDisplay, window)) {
-        cout << COLOR_RED << "dox11cmd: Error "
-            "trying to map the Window." << COLOR_NORMAL << endl;
+    if (workspace != ALL_WORKSPACES) {
+        const vector<size_t>& indexes = mSnapshot->getWorkspaceWindows(
+            workspace);
+        for (int i = indexes.size() - 1; i >= 0; i--) {
+            writeListRow(out, display, indexes[i], rowCount);
+        }
         return;
     }
+
+    for (int i = mSnapshot->size() - 1; i >= 0; i--) {
+        writeListRow(out, display, i, rowCount);
+    }
 }
 
 /**
- * Supported Commands unmap.
+ * Helper writes one of the current snapshot's Windows.
  */
-void doUnmapWindow(string windowString) {
-    Window window = getWindowWithBestName(windowString);
-    if (!window) {
-        cout << COLOR_RED << "\ndox11cmd: Cannot find a Window "
-            "by that name." << COLOR_NORMAL << endl;
-        return;
+void writeListRow(OutputWriter& out, const char* display, size_t i,
+        size_t* rowCount) {
+    WinInfo* winInfoItem = mSnapshot->getInfo(i);
+    WindowRegionIndex& regions = getRegionIndex();
+    string outputTitle;
+
+    switch (out.getFormat()) {
+        case FORMAT_TSV:
+            if (display) {
+                out << display << '\t';
+            }
+            out.appendHex(winInfoItem->id, 8);
+            out << '\t' << getWatchText(mSnapshot->getTitle(i)) <<
+                '\t' << winInfoItem->ws << '\t' << winInfoItem->pid <<
+                '\t' << winInfoItem->xa << '\t' << winInfoItem->ya <<
+                '\t' << winInfoItem->w << '\t' << winInfoItem->h <<
+                '\t' << (winInfoItem->desktop ? '1' : '0') <<
+                '\t' << (winInfoItem->dock ? '1' : '0') <<
+                '\t' << (winInfoItem->sticky ? '1' : '0') <<
+                '\t' << (winInfoItem->hidden ? '1' : '0') <<
+                '\t' << regions.getVisibleArea(i) <<
+                '\t' << regions.getVisiblePercent(i) << '\n';
+            break;
+
+        case FORMAT_JSON:
+            out << (*rowCount ? ",\n{" : "\n{");
+            if (display) {
+                out << "\"display\":";
+                out.appendJson(display);
+                out << ',';
+            }
+            out << "\"id\":" << winInfoItem->id << ",\"title\":";
+            out.appendJson(mSnapshot->getTitle(i));
+            out << ",\"ws\":" << winInfoItem->ws <<
+                ",\"pid\":" << winInfoItem->pid <<
+                ",\"x\":" << winInfoItem->xa <<
+                ",\"y\":" << winInfoItem->ya <<
+                ",\"w\":" << winInfoItem->w <<
+                ",\"h\":" << winInfoItem->h <<
+                ",\"desktop\":" <<
+                    (winInfoItem->desktop ? "true" : "false") <<
+                ",\"dock\":" << (winInfoItem->dock ? "true" : "false") <<
+                ",\"sticky\":" <<
+                    (winInfoItem->sticky ? "true" : "false") <<
+                ",\"hidden\":" <<
+                    (winInfoItem->hidden ? "true" : "false") <<
+                ",\"visible\":" << regions.getVisibleArea(i) <<
+                ",\"visible_pct\":" << regions.getVisiblePercent(i) <<
+                '}';
+            break;
+
+        default:
+            if (display) {
+                const size_t length = strlen(display);
+                out << display <<
+                    string(length < 10 ? 12 - length : 2, ' ');
+            }
+
+            // Create a formatted title (name) with a hard display
+            // width, replacing unprintables with SPACE, padding
+            // right with SPACE.
+            appendFixedWidth(outputTitle, mSnapshot->getTitle(i),
+                MAX_TITLE_STRING_LENGTH);
+
+            // Log a WinInfo struct.
+            out << '[';
+            out.appendHex(winInfoItem->id, 8);
+            out << "]  " << outputTitle << "  ";
+            out.appendNumber(winInfoItem->ws, 2, false);
+            out << "   ";
+            out.appendNumber(winInfoItem->xa, 5, false);
+            out << " , ";
+            out.appendNumber(winInfoItem->ya, 5, true);
+            out << ' ';
+            out.appendNumber(winInfoItem->w, 5, false);
+            out << " x ";
+            out.appendNumber(winInfoItem->h, 5, true);
+            out << "  ";
+            out.appendNumber(regions.getVisiblePercent(i), 3, false);
+            out << "%  " <<
+                (winInfoItem->desktop ? "desktop " : "") <<
+                (winInfoItem->dock ? "dock " : "") <<
+                (winInfoItem->sticky ? "sticky " : "") <<
+                (winInfoItem->hidden ? "hidden" : "") << '\n';
     }
+    (*rowCount)++;
+}
 
-    if(!XUnmapWindow(mDisplay, window)) {
-        cout << COLOR_RED << "dox11cmd: Error trying to "
-            "unmap the Window ?? FATAL." << COLOR_NORMAL << endl;
-        return;
+/**
+ * Helper writes what follows the rows.
+ */
+void writeListFooter(OutputWriter& out) {
+    if (out.getFormat() == FORMAT_JSON) {
+        out << "\n]\n";
     }
 }
 
 /**
- * Helper to search for Window Id whose name matches.
+ * Helper writes list as the binary WinInfo record stream.
  */
-Window getWindowWithBestName(string name) {
-    Window result = getWindowWithExactName(name);
-    if (result) {
-        return result;
+void writeListBin(OutputWriter& out, long workspace) {
+    const string& titleArena = mSnapshot->getTitleArena();
+
+    // Just one workspace's records; their titles are where they
+    // are in the whole arena.
+    const vector<size_t>* indexes = workspace == ALL_WORKSPACES ? NULL :
+        &mSnapshot->getWorkspaceWindows(workspace);
+    const size_t count = indexes ? indexes->size() : mSnapshot->size();
+
+    WinInfoStreamHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = WIN_INFO_STREAM_MAGIC;
+    header.version = WIN_INFO_STREAM_VERSION;
+    header.recordSize = sizeof(WinInfoRecord);
+    header.count = count;
+    header.titleArenaLength = titleArena.size();
+    out.write(&header, sizeof(header));
+
+    for (int i = count - 1; i >= 0; i--) {
+        WinInfo* winInfoItem = mSnapshot->getInfo(indexes ?
+            (*indexes)[i] : i);
+
+        WinInfoRecord record;
+        memset(&record, 0, sizeof(record));
+        record.id = winInfoItem->id;
+        record.ws = winInfoItem->ws;
+        record.pid = winInfoItem->pid;
+        record.x = winInfoItem->x;
+        record.y = winInfoItem->y;
+        record.xa = winInfoItem->xa;
+        record.ya = winInfoItem->ya;
+        record.w = winInfoItem->w;
+        record.h = winInfoItem->h;
+        record.titleOffset = winInfoItem->titleOffset;
+        record.titleLength = winInfoItem->titleLength;
+        record.flags =
+            (winInfoItem->sticky ? WIN_INFO_STICKY : 0) |
+            (winInfoItem->dock ? WIN_INFO_DOCK : 0) |
+            (winInfoItem->desktop ? WIN_INFO_DESKTOP : 0) |
+            (winInfoItem->hidden ? WIN_INFO_HIDDEN : 0);
+        out.write(&record, sizeof(record));
     }
 
-    return getWindowWithPartialName(name);
+    out.write(titleArena.data(), titleArena.size());
 }
 
 /**
- * Helper to search for Window Id whose name matches.
+ * Supported Commands - raise. With --all, bottom-most first, so
+ * the matches keep their relative order.
  */
-Window getWindowWithExactName(string name) {
-    Window* stackedWins;
-    int numberOfStackedWins = getX11StackedWindowsList(&stackedWins);
+void doRaiseWindow(string windowString, bool isAll, OutputWriter& out) {
+    const vector<Window> windows = getWindowsWithBestName(windowString,
+        isAll);
+    if (windows.empty()) {
+        out << COLOR_RED << "\ndox11cmd: Cannot find a Window "
+            "by that name." << COLOR_NORMAL << "\n";
+        return;
+    }
 
-    for (int i = numberOfStackedWins - 1; i >= 0; i--) {
-        XTextProperty titleBarName;
-        XGetWMName(mDisplay, stackedWins[i], &titleBarName);
+    for (int i = windows.size() - 1; i >= 0; i--) {
+        mSession->raiseWindow(windows[i]);
+    }
+}
 
-        // Exact match includes empty nameString.
-        string titleBarString(reinterpret_cast<char const*>
-            (titleBarName.value));
-        string nameString(name);
-        if (titleBarString == nameString) {
-            XFree(titleBarName.value);
-            return stackedWins[i];
-        }
+/**
+ * Supported Commands - lower. With --all, top-most first, so the
+ * matches keep their relative order.
+ */
+void doLowerWindow(string windowString, bool isAll, OutputWriter& out) {
+    const vector<Window> windows = getWindowsWithBestName(windowString,
+        isAll);
+    if (windows.empty()) {
+        out << COLOR_RED << "\ndox11cmd: Cannot find a Window "
+            "by that name." << COLOR_NORMAL << "\n";
+        return;
+    }
 
-        XFree(titleBarName.value);
+    for (size_t i = 0; i < windows.size(); i++) {
+        mSession->lowerWindow(windows[i]);
     }
+}
 
-    return None;
+/**
+ * Supported Commands - map.
+ */
+void doMapWindow(string windowString, bool isAll, OutputWriter& out) {
+    const vector<Window> windows = getWindowsWithBestName(windowString,
+        isAll);
+    if (windows.empty()) {
+        out << COLOR_RED << "\ndox11cmd: Cannot find a Window "
+            "by that name." << COLOR_NORMAL << "\n";
+        return;
+    }
+
+    for (size_t i = 0; i < windows.size(); i++) {
+        mSession->mapWindow(windows[i]);
+    }
 }
 
 /**
- * Helper to search for Window Id whose name matches.
+ * Supported Commands unmap.
  */
-Window getWindowWithPartialName(string name) {
-    Window* stackedWins;
-    int numberOfStackedWins = getX11StackedWindowsList(&stackedWins);
+void doUnmapWindow(string windowString, bool isAll, OutputWriter& out) {
+    const vector<Window> windows = getWindowsWithBestName(windowString,
+        isAll);
+    if (windows.empty()) {
+        out << COLOR_RED << "\ndox11cmd: Cannot find a Window "
+            "by that name." << COLOR_NORMAL << "\n";
+        return;
+    }
 
-    for (int i = numberOfStackedWins - 1; i >= 0; i--) {
-        XTextProperty titleBarName;
-        XGetWMName(mDisplay, stackedWins[i], &titleBarName);
+    for (size_t i = 0; i < windows.size(); i++) {
+        mSession->unmapWindow(windows[i]);
+    }
+}
+
+/**
+ * Supported Commands - restack.
+ *
+ * WINDOWs are given top-most first. Only the Windows outside the
+ * longest run already in the desired relative order are moved,
+ * so the request count is the minimum number of sibling moves.
+ */
+void doRestackWindows(const vector<string>& windowStrings,
+        OutputWriter& out) {
+    // Desired order, bottom-most first, with current positions.
+    vector<Window> desired;
+    vector<int> positions;
+    for (int i = windowStrings.size() - 1; i >= 0; i--) {
+        Window window = getWindowWithBestName(windowStrings[i]);
+        if (!window) {
+            out << COLOR_RED << "\ndox11cmd: Cannot find a Window "
+                "by the name \"" << windowStrings[i] << "\"." <<
+                COLOR_NORMAL << "\n";
+            return;
+        }
+        if (find(desired.begin(), desired.end(), window) !=
+                desired.end()) {
+            continue;
+        }
+        desired.push_back(window);
+        positions.push_back(mSnapshot->findWindow(window));
+    }
 
-        // Else grab partial.
-        string titleBarString(reinterpret_cast<char const*>
-            (titleBarName.value));
-        string nameString(name);
-        if (!nameString.empty() &&
-            titleBarString.find(nameString) != string::npos) {
-            XFree(titleBarName.value);
-            return stackedWins[i];
+    // Longest increasing run of current positions (patience
+    // sort), i.e. the longest common subsequence of the desired
+    // and current orders.
+    vector<int> tailIndexes;
+    vector<int> previous(desired.size(), -1);
+    for (size_t k = 0; k < desired.size(); k++) {
+        auto tail = lower_bound(tailIndexes.begin(), tailIndexes.end(),
+            positions[k], [&positions](int index, int position) {
+                return positions[index] < position;
+            });
+        if (tail != tailIndexes.begin()) {
+            previous[k] = *(tail - 1);
+        }
+        if (tail == tailIndexes.end()) {
+            tailIndexes.push_back(k);
+        } else {
+            *tail = k;
         }
+    }
 
-        XFree(titleBarName.value);
+    vector<bool> isKept(desired.size(), false);
+    int lowestKept = -1;
+    for (int k = tailIndexes.empty() ? -1 : tailIndexes.back();
+            k >= 0; k = previous[k]) {
+        isKept[k] = true;
+        lowestKept = k;
     }
 
-    return None;
+    // Move the rest, bottom up, each directly above its desired
+    // neighbour below (the lowest ones go under the first kept).
+    for (size_t k = 0; k < desired.size(); k++) {
+        if (isKept[k]) {
+            continue;
+        }
+        if (k == 0) {
+            mSession->restackWindow("restack", desired[k],
+                desired[lowestKept], Below);
+        } else {
+            mSession->restackWindow("restack", desired[k],
+                desired[k - 1], Above);
+        }
+    }
 }
 
 /**
- * Helper method gets the X11 stacked windows list.
+ * Supported Commands - at: the top-most Window at a point, from
+ * the snapshot's region index, listed like list does.
  */
-unsigned long
-getX11StackedWindowsList(Window** windows) {
-    return getRootWindowProperty(XInternAtom(mDisplay,
-        "_NET_CLIENT_LIST_STACKING", False), windows);
+void doWindowAt(const vector<string>& point, OutputWriter& out) {
+    long x = 0, y = 0;
+    char* end = NULL;
+    bool isValid = point.size() == 2;
+    for (size_t i = 0; isValid && i < 2; i++) {
+        (i ? y : x) = strtol(point[i].c_str(), &end, 10);
+        isValid = !point[i].empty() && *end == '\0';
+    }
+    if (!isValid) {
+        out << COLOR_RED << "\ndox11cmd: at takes an X Y point." <<
+            COLOR_NORMAL << "\n";
+        return;
+    }
+
+    const int index = getRegionIndex().findWindowAt(x, y);
+    if (index < 0 && out.getFormat() == FORMAT_TEXT) {
+        out << COLOR_YELLOW << "\ndox11cmd: No Window at " << x <<
+            ", " << y << "." << COLOR_NORMAL << "\n";
+        return;
+    }
+
+    size_t rowCount = 0;
+    writeListHeader(out, false);
+    if (index >= 0) {
+        writeListRow(out, NULL, index, &rowCount);
+    }
+    writeListFooter(out);
 }
 
 /**
- * Helper method gets a requested root window property.
+ * Supported Commands - snapshot: the list --format=bin stream,
+ * saved to a file for diff, or any reader that maps it.
  */
-unsigned long
-getRootWindowProperty(Atom property, Window** windows) {
-    Atom da;
-    int di;
-    unsigned long len;
-    unsigned long dl;
-    unsigned char* list;
-
-    if (XGetWindowProperty(mDisplay, DefaultRootWindow(mDisplay),
-            property, 0L, 1024, False, XA_WINDOW, &da, &di,
-            &len, &dl, &list) != Success) {
-        *windows = NULL;
-        return 0;
+void doSnapshot(const vector<string>& options, OutputWriter& out) {
+    if (options.size() != 2 || options[0] != "--out") {
+        out << COLOR_RED << "\ndox11cmd: snapshot takes --out FILE." <<
+            COLOR_NORMAL << "\n";
+        return;
     }
-
-    *windows = (Window*) list;
-    return len;
+    writeSnapshotFile(options[1], out);
 }
 
 /**
- * This method determines if a window is visible on a workspace.
+ * Supported Commands - diff: two snapshot files, mapped, matched
+ * by Window id, as watch records from the first to the second.
+ * As diff(1): 0 if the same, 1 if not, 2 if either can't be read.
  */
-long int getWindowWorkspace(Window window) {
-    long int result = 0;
+int doDiffSnapshots(const vector<string>& paths, OutputWriter& out) {
+    if (paths.size() != 2) {
+        out << COLOR_RED << "\ndox11cmd: diff takes two snapshot "
+            "FILEs." << COLOR_NORMAL << "\n";
+        return 2;
+    }
 
-    Atom type;
-    int format;
-    unsigned long nitems, unusedBytes;
-    unsigned char* properties = NULL;
+    SnapshotFile oldFile;
+    SnapshotFile newFile;
+    if (!oldFile.open(paths[0]) || !newFile.open(paths[1])) {
+        out << COLOR_RED << "\ndox11cmd: " << (oldFile.getError().empty() ?
+            newFile.getError() : oldFile.getError()) << "." <<
+            COLOR_NORMAL << "\n";
+        return 2;
+    }
+
+    unordered_map<Window, size_t> oldIndexes;
+    oldIndexes.reserve(oldFile.size());
+    for (size_t i = 0; i < oldFile.size(); i++) {
+        oldIndexes[oldFile.getRecord(i)->id] = i;
+    }
+
+    // Surviving Windows, in old & new order, to spot a restack.
+    vector<Window> oldOrder;
+    vector<Window> newOrder;
+    unordered_set<Window> isSurviving;
+    bool isDifferent = false;
+
+    for (size_t i = 0; i < newFile.size(); i++) {
+        const WinInfo winInfoItem = newFile.getInfo(i);
+        auto old = oldIndexes.find(winInfoItem.id);
+        if (old == oldIndexes.end()) {
+            writeWatchAdd(winInfoItem, newFile.getTitle(i), out);
+            isDifferent = true;
+            continue;
+        }
 
-    XGetWindowProperty(mDisplay, window,
-        XInternAtom(mDisplay, "_NET_WM_DESKTOP", False),
-        0, 1, False, AnyPropertyType, &type, &format, &nitems,
-        &unusedBytes, &properties);
+        newOrder.push_back(winInfoItem.id);
+        isSurviving.insert(winInfoItem.id);
 
-    if (type != XA_CARDINAL) {
-        XFree(properties);
-        properties = NULL;
+        // Unchanged records are equal byte for byte, but for
+        // where their titles sit in the arena.
+        const WinInfoRecord* record = newFile.getRecord(i);
+        const WinInfoRecord* oldRecord = oldFile.getRecord(old->second);
+        if (memcmp(record, oldRecord, offsetof(WinInfoRecord,
+                titleOffset)) == 0 && record->flags == oldRecord->flags &&
+                newFile.getTitle(i) == oldFile.getTitle(old->second)) {
+            continue;
+        }
+        isDifferent |= writeWatchChanges(oldFile.getInfo(old->second),
+            oldFile.getTitle(old->second), winInfoItem,
+            newFile.getTitle(i), out);
+    }
 
-        XGetWindowProperty(mDisplay, window,
-            XInternAtom(mDisplay, "_WIN_WORKSPACE", False),
-            0, 1, False, AnyPropertyType, &type, &format, &nitems,
-            &unusedBytes, &properties);
+    for (size_t i = 0; i < oldFile.size(); i++) {
+        const Window window = oldFile.getRecord(i)->id;
+        if (isSurviving.count(window)) {
+            oldOrder.push_back(window);
+        } else {
+            out << "remove ";
+            out.appendHex(window, 8);
+            out << "\n";
+            isDifferent = true;
+        }
     }
 
-    if (properties) {
-        result = *(long*) (void*) properties;
-        XFree(properties);
+    if (oldOrder != newOrder) {
+        out << "restack";
+        for (size_t i = 0; i < newFile.size(); i++) {
+            out << " ";
+            out.appendHex(newFile.getRecord(i)->id, 8);
+        }
+        out << "\n";
+        isDifferent = true;
     }
 
-    return result;
+    return isDifferent ? 1 : 0;
+}
+
+/**
+ * Supported Commands - watch.
+ *
+ * Streams one line per change until interrupted:
+ *
+ *    add 0xID WS XA YA W H TITLE
+ *    remove 0xID
+ *    retitle 0xID TITLE
+ *    move 0xID XA YA W H
+ *    state 0xID WS [desktop] [dock] [sticky] [hidden]
+ *    restack 0xID ...   (top-most first)
+ *    active 0xID
+ *
+ * Blocks in XNextEvent between changes; nothing is polled.
+ */
+void doWatchWindows(OutputWriter& out) {
+    mSnapshot->selectEvents();
+
+    while (true) {
+        XEvent event;
+        XNextEvent(mDisplay, &event);
+        bool isChanged = mSnapshot->handleEvent(event);
+        while (XPending(mDisplay)) {
+            XNextEvent(mDisplay, &event);
+            isChanged |= mSnapshot->handleEvent(event);
+        }
+        if (!isChanged) {
+            continue;
+        }
+
+        // Before & after images.
+        vector<WinInfo> oldInfos;
+        for (size_t i = 0; i < mSnapshot->size(); i++) {
+            oldInfos.push_back(*mSnapshot->getInfo(i));
+        }
+        const string oldTitleArena = mSnapshot->getTitleArena();
+        const Window oldActiveWindow = mSnapshot->getActiveWindow();
+
+        mSnapshot->update();
+
+        writeWatchRecords(oldInfos, oldTitleArena, oldActiveWindow, out);
+        out.flush();
+    }
 }
 
 /**
- * This method determines if a window state is sticky.
+ * Helper writes watch records for what changed between a
+ * before image and the current snapshot.
  */
-bool isWindow_Sticky(long workSpace, WinInfo* winInfoItem) {
-    // Needed in KDE and LXDE.
-    if (workSpace == -1) {
-        return true;
+void writeWatchRecords(const vector<WinInfo>& oldInfos,
+        const string& oldTitleArena, Window oldActiveWindow,
+        OutputWriter& out) {
+    unordered_map<Window, size_t> oldIndexes;
+    for (size_t i = 0; i < oldInfos.size(); i++) {
+        oldIndexes[oldInfos[i].id] = i;
     }
 
-    bool result = false;
+    // Surviving Windows, in old & new order, to spot a restack.
+    vector<Window> oldOrder;
+    vector<Window> newOrder;
+    unordered_set<Window> isSurviving;
+
+    for (size_t i = 0; i < mSnapshot->size(); i++) {
+        const WinInfo* winInfoItem = mSnapshot->getInfo(i);
+        const string_view title = mSnapshot->getTitle(i);
 
-    Atom type;
-    int format;
-    unsigned long nitems, unusedBytes;
-    unsigned char* properties = NULL;
+        auto old = oldIndexes.find(winInfoItem->id);
+        if (old == oldIndexes.end()) {
+            writeWatchAdd(*winInfoItem, title, out);
+            continue;
+        }
 
-    XGetWindowProperty(mDisplay, winInfoItem->id,
-        XInternAtom(mDisplay, "_NET_WM_STATE", False),
-        0, (~0L), False, AnyPropertyType, &type, &format,
-        &nitems, &unusedBytes, &properties);
+        newOrder.push_back(winInfoItem->id);
+        isSurviving.insert(winInfoItem->id);
 
-    if (type == XA_ATOM) {
-        for (unsigned long int i = 0; i < nitems; i++) {
-            char* nameString = XGetAtomName(mDisplay,
-                ((Atom*) (void*) properties) [i]);
-            if (strcmp(nameString, "_NET_WM_STATE_STICKY") == 0) {
-                result = true;
-                XFree(nameString);
-                break;
-            }
-            XFree(nameString);
+        const WinInfo* oldInfoItem = &oldInfos[old->second];
+        const string_view oldTitle(oldTitleArena.data() +
+            oldInfoItem->titleOffset, oldInfoItem->titleLength);
+
+        writeWatchChanges(*oldInfoItem, oldTitle, *winInfoItem, title,
+            out);
+    }
+
+    for (size_t i = 0; i < oldInfos.size(); i++) {
+        if (isSurviving.count(oldInfos[i].id)) {
+            oldOrder.push_back(oldInfos[i].id);
+        } else {
+            out << "remove ";
+            out.appendHex(oldInfos[i].id, 8);
+            out << "\n";
         }
     }
 
-    XFree(properties);
-    return result;
+    if (oldOrder != newOrder) {
+        out << "restack";
+        for (int i = mSnapshot->size() - 1; i >= 0; i--) {
+            out << " ";
+            out.appendHex(mSnapshot->getInfo(i)->id, 8);
+        }
+        out << "\n";
+    }
+
+    if (mSnapshot->getActiveWindow() != oldActiveWindow) {
+        out << "active ";
+        out.appendHex(mSnapshot->getActiveWindow(), 8);
+        out << "\n";
+    }
 }
 
 /**
- * This method checks for a _NET_WM_WINDOW_TYPE of
- * _NET_WM_WINDOW_TYPE_DOCK.
+ * Helper writes the watch record of a new Window.
  */
-bool isWindow_Dock(WinInfo* winInfoItem) {
-    bool result = false;
-
-    Atom type;
-    int format;
-    unsigned long nitems, unusedBytes;
-    unsigned char* properties = NULL;
+void writeWatchAdd(const WinInfo& winInfoItem, string_view title,
+        OutputWriter& out) {
+    out << "add ";
+    out.appendHex(winInfoItem.id, 8);
+    out << " " << winInfoItem.ws << " " << winInfoItem.xa << " " <<
+        winInfoItem.ya << " " << winInfoItem.w << " " << winInfoItem.h <<
+        " " << getWatchText(title) << "\n";
+}
 
-    XGetWindowProperty(mDisplay, winInfoItem->id,
-        XInternAtom(mDisplay, "_NET_WM_WINDOW_TYPE", False),
-        0, (~0L), False, AnyPropertyType, &type, &format,
-        &nitems, &unusedBytes, &properties);
+/**
+ * Helper writes the watch records of what changed in one Window.
+ * True if there were any.
+ */
+bool writeWatchChanges(const WinInfo& oldInfoItem, string_view oldTitle,
+        const WinInfo& winInfoItem, string_view title,
+        OutputWriter& out) {
+    bool isChanged = false;
+    if (title != oldTitle) {
+        out << "retitle ";
+        out.appendHex(winInfoItem.id, 8);
+        out << " " << getWatchText(title) << "\n";
+        isChanged = true;
+    }
+    if (winInfoItem.xa != oldInfoItem.xa ||
+            winInfoItem.ya != oldInfoItem.ya ||
+            winInfoItem.w != oldInfoItem.w ||
+            winInfoItem.h != oldInfoItem.h) {
+        out << "move ";
+        out.appendHex(winInfoItem.id, 8);
+        out << " " << winInfoItem.xa << " " << winInfoItem.ya << " " <<
+            winInfoItem.w << " " << winInfoItem.h << "\n";
+        isChanged = true;
+    }
+    if (winInfoItem.ws != oldInfoItem.ws ||
+            winInfoItem.desktop != oldInfoItem.desktop ||
+            winInfoItem.dock != oldInfoItem.dock ||
+            winInfoItem.sticky != oldInfoItem.sticky ||
+            winInfoItem.hidden != oldInfoItem.hidden) {
+        out << "state ";
+        out.appendHex(winInfoItem.id, 8);
+        out << " " << winInfoItem.ws <<
+            (winInfoItem.desktop ? " desktop" : "") <<
+            (winInfoItem.dock ? " dock" : "") <<
+            (winInfoItem.sticky ? " sticky" : "") <<
+            (winInfoItem.hidden ? " hidden" : "") << "\n";
+        isChanged = true;
+    }
+    return isChanged;
+}
 
-    if (format == 32) {
-        for (int i = 0; (unsigned long)i < nitems; i++) {
-            char* nameString = XGetAtomName(mDisplay,
-                ((Atom*) (void*) properties) [i]);
-            if (strcmp(nameString, "_NET_WM_WINDOW_TYPE_DOCK") == 0) {
-                result = true;
-                XFree(nameString);
-                break;
-            }
-            XFree(nameString);
+/**
+ * Helper keeps a title on one record line.
+ */
+string getWatchText(string_view text) {
+    string result(text);
+    for (size_t i = 0; i < result.size(); i++) {
+        if ((unsigned char) result[i] < 0x20) {
+            result[i] = ' ';
         }
     }
-
-    XFree(properties);
     return result;
 }
 
 /**
- * This method determines if a window state is hidden.
+ * Helper to search for Window Id whose name matches.
+ */
+Window getWindowWithBestName(string name) {
+    StatsPhase phase(STATS_MATCH);
+    WindowMatcher matcher(name);
+    return matcher.matchFirst(*mSnapshot);
+}
+
+/**
+ * Supported Commands - capture: a Window's pixels, where it is on
+ * screen, as binary PPM (or --rgba, raw RGBA rows) to stdout or
+ * --out FILE. With --all, every visible match (or every visible
+ * Window), each to PATH/0xID.ppm (or .rgba), with one line per
+ * file written: ID, size & path.
  */
-bool isWindow_Hidden(Window window, int windowMapState) {
-    if (!isDesktop_Visible()) {
-        return true;
+void doCaptureWindows(const vector<string>& options,
+        OutputWriter& out) {
+    bool isAll = false;
+    bool isRgba = false;
+    bool isValid = true;
+    string path;
+    string name;
+    for (size_t i = 0; i < options.size(); i++) {
+        if (options[i] == "--all") {
+            isAll = true;
+        } else if (options[i] == "--rgba") {
+            isRgba = true;
+        } else if (options[i] == "--out" && i + 1 < options.size()) {
+            path = options[++i];
+        } else if (i == options.size() - 1) {
+            name = options[i];
+        } else {
+            isValid = false;
+        }
     }
-    if (windowMapState != IsViewable) {
-        return true;
+    if (!isValid || (!isAll && name.empty())) {
+        out << COLOR_RED << "\ndox11cmd: capture takes [--all] [--rgba] "
+            "[--out PATH] WINDOW." << COLOR_NORMAL << "\n";
+        return;
+    }
+    if (!mDisplay) {
+        out << COLOR_RED << "\ndox11cmd: capture needs an X server." <<
+            COLOR_NORMAL << "\n";
+        return;
     }
 
-    if (isNetWM_Hidden(window)) {
-        return true;
+    // Top-most first.
+    vector<size_t> indexes;
+    if (isAll) {
+        vector<size_t> matches;
+        if (name.empty()) {
+            for (int i = mSnapshot->size() - 1; i >= 0; i--) {
+                matches.push_back(i);
+            }
+        } else {
+            StatsPhase phase(STATS_MATCH);
+            WindowMatcher matcher(name);
+            matches = matcher.match(*mSnapshot);
+        }
+        for (size_t i = 0; i < matches.size(); i++) {
+            if (getRegionIndex().getVisibleArea(matches[i]) > 0) {
+                indexes.push_back(matches[i]);
+            }
+        }
+    } else {
+        const Window window = getWindowWithBestName(name);
+        if (window) {
+            indexes.push_back(mSnapshot->findWindow(window));
+        }
     }
-    if (isWM_Hidden(window)) {
-        return true;
+    if (indexes.empty()) {
+        out << COLOR_RED << "\ndox11cmd: Cannot find a Window "
+            "by that name." << COLOR_NORMAL << "\n";
+        return;
+    }
+
+    if (!mCapture) {
+        mCapture = new WindowCapture(mDisplayHelper);
     }
+    for (size_t n = 0; n < indexes.size(); n++) {
+        const WinInfo* winInfoItem = mSnapshot->getInfo(indexes[n]);
+
+        // Only what is on screen can be read.
+        const long left = max(winInfoItem->xa, 0);
+        const long top = max(winInfoItem->ya, 0);
+        const long right = min((long) winInfoItem->xa + winInfoItem->w,
+            (long) mSnapshot->getRootWidth());
+        const long bottom = min((long) winInfoItem->ya + winInfoItem->h,
+            (long) mSnapshot->getRootHeight());
+
+        const bool isOnScreen = !winInfoItem->hidden && right > left &&
+            bottom > top;
+        XImage* image = NULL;
+        if (isOnScreen) {
+            LayoutRect rect;
+            rect.x = left - winInfoItem->xa;
+            rect.y = top - winInfoItem->ya;
+            rect.w = right - left;
+            rect.h = bottom - top;
+
+            int depth = 0;
+            unsigned long visual = 0;
+            mSnapshot->getPixelFormat(indexes[n], &depth, &visual);
+
+            mSession->setErrorsQuiet(true);
+            image = mCapture->capture(winInfoItem->id, depth, visual,
+                rect);
+            mSession->setErrorsQuiet(false);
+        }
+        if (!image) {
+            out << COLOR_RED << "dox11cmd: Cannot capture Window ";
+            out.appendHex(winInfoItem->id, 8);
+            out << (isOnScreen ? ": cannot read it." : ": not on screen.") <<
+                COLOR_NORMAL << "\n";
+            continue;
+        }
+
+        // One Window, no --out: stdout.
+        if (!isAll && path.empty()) {
+            if (!writeCaptureImage(out, image, isRgba)) {
+                out << COLOR_RED << "dox11cmd: Cannot convert "
+                    "that pixel format." << COLOR_NORMAL << "\n";
+            }
+            continue;
+        }
 
-    return false;
+        string filePath = path;
+        if (isAll) {
+            OutputWriter fileName(-1);
+            fileName.appendHex(winInfoItem->id, 8);
+            filePath = (path.empty() ? "." : path) + "/" +
+                fileName.getBuffer() + (isRgba ? ".rgba" : ".ppm");
+        }
+        // A format that can't be converted leaves any old file.
+        bool isConverted = true;
+        if (writeFileWhole(filePath, [&](OutputWriter& file) {
+                isConverted = writeCaptureImage(file, image, isRgba);
+                return isConverted;
+            }, out)) {
+            out.appendHex(winInfoItem->id, 8);
+            out << ' ' << image->width << ' ' << image->height << ' ' <<
+                filePath << '\n';
+        } else if (!isConverted) {
+            out << COLOR_RED << "dox11cmd: Cannot convert the pixel "
+                "format of Window ";
+            out.appendHex(winInfoItem->id, 8);
+            out << "." << COLOR_NORMAL << "\n";
+        }
+    }
 }
 
 /**
- * This method checks for window _NET_SHOWING_DESKTOP property.
+ * Supported Commands - wait: block until WINDOW matches, then
+ * print its id & title. Or, until a match is mapped & not hidden
+ * (--mapped), until nothing matches (--gone), or until the best
+ * match's title differs from when it was first seen
+ * (--title-changes). --timeout N gives up after N seconds.
+ * Exits 0 when met, 1 on timeout, 2 if it can't wait.
+ *
+ * The root & every candidate report changes as events, and only
+ * what they made stale is re-read; in between, this sleeps in
+ * poll() on the connection.
  */
-bool isDesktop_Visible() {
-    bool result = true;
+void doWaitForWindow(const vector<string>& options, OutputWriter& out) {
+    bool isMapped = false;
+    bool isGone = false;
+    bool isTitleChange = false;
+    bool isValid = true;
+    double timeout = -1;
+    string name;
+    for (size_t i = 0; i < options.size(); i++) {
+        if (options[i] == "--mapped") {
+            isMapped = true;
+        } else if (options[i] == "--gone") {
+            isGone = true;
+        } else if (options[i] == "--title-changes") {
+            isTitleChange = true;
+        } else if (options[i] == "--timeout" && i + 1 < options.size()) {
+            const char* value = options[++i].c_str();
+            char* end = NULL;
+            timeout = strtod(value, &end);
+            isValid &= end != value && !*end && timeout >= 0;
+        } else if (name.empty()) {
+            name = options[i];
+        } else {
+            isValid = false;
+        }
+    }
+    mCommandStatus = 2;
+    if (!isValid || name.empty() || isMapped + isGone + isTitleChange > 1) {
+        out << COLOR_RED << "\ndox11cmd: wait takes [--mapped|--gone|"
+            "--title-changes] WINDOW [--timeout N]." << COLOR_NORMAL <<
+            "\n";
+        return;
+    }
+    WindowMatcher matcher(name);
+    if (!matcher.isValid()) {
+        out << COLOR_RED << "\ndox11cmd: " << matcher.getError() << "." <<
+            COLOR_NORMAL << "\n";
+        return;
+    }
+    if (!mDisplay) {
+        out << COLOR_RED << "\ndox11cmd: wait needs an X server." <<
+            COLOR_NORMAL << "\n";
+        return;
+    }
+
+    const chrono::steady_clock::time_point deadline =
+        chrono::steady_clock::now() +
+        chrono::duration_cast<chrono::steady_clock::duration>(
+            chrono::duration<double>(timeout));
+
+    // Select, then re-read: nothing changed in between is missed.
+    mSnapshot->selectEvents();
+    mSnapshot->markStale();
+    mSnapshot->update();
+
+    Window titleWindow = None;
+    string title;
+    while (true) {
+        Window window = None;
+        {
+            StatsPhase phase(STATS_MATCH);
+            if (isGone) {
+                if (matcher.match(*mSnapshot).empty()) {
+                    break;
+                }
+            } else if (isMapped) {
+                const vector<size_t> matches = matcher.match(*mSnapshot);
+                for (size_t i = 0; i < matches.size() && !window; i++) {
+                    if (!mSnapshot->getInfo(matches[i])->hidden) {
+                        window = mSnapshot->getInfo(matches[i])->id;
+                    }
+                }
+            } else if (!isTitleChange) {
+                window = matcher.matchFirst(*mSnapshot);
+            } else if (!titleWindow) {
+                titleWindow = matcher.matchFirst(*mSnapshot);
+                if (titleWindow) {
+                    title = mSnapshot->getTitle(
+                        mSnapshot->findWindow(titleWindow));
+                }
+            } else {
+                const int index = mSnapshot->findWindow(titleWindow);
+                if (index < 0) {
+                    out << COLOR_RED << "\ndox11cmd: The Window closed "
+                        "with its title unchanged." << COLOR_NORMAL <<
+                        "\n";
+                    mCommandStatus = 1;
+                    return;
+                }
+                if (mSnapshot->getTitle(index) != title) {
+                    window = titleWindow;
+                }
+            }
+        }
+        if (window) {
+            const int index = mSnapshot->findWindow(window);
+            out.appendHex(window, 8);
+            out << " " << getWatchText(mSnapshot->getTitle(index)) << "\n";
+            break;
+        }
 
-    Atom type;
-    int format;
-    unsigned long nitems, unusedBytes;
-    unsigned char* properties = NULL;
+        // Sleep until the server has something, or the deadline.
+        while (!XPending(mDisplay)) {
+            int waitMilliseconds = -1;
+            if (timeout >= 0) {
+                const long remaining = chrono::duration_cast<
+                    chrono::milliseconds>(deadline -
+                    chrono::steady_clock::now()).count();
+                if (remaining <= 0) {
+                    out << COLOR_RED << "\ndox11cmd: Timed out waiting "
+                        "for " << name << "." << COLOR_NORMAL << "\n";
+                    mCommandStatus = 1;
+                    return;
+                }
+                waitMilliseconds = remaining;
+            }
 
-    XGetWindowProperty(mDisplay, DefaultRootWindow(mDisplay),
-        XInternAtom(mDisplay, "_NET_SHOWING_DESKTOP", False),
-        0, (~0L), False, AnyPropertyType, &type, &format,
-        &nitems, &unusedBytes, &properties);
+            pollfd fd;
+            fd.fd = ConnectionNumber(mDisplay);
+            fd.events = POLLIN;
+            if (poll(&fd, 1, waitMilliseconds) < 0 && errno != EINTR) {
+                out << COLOR_RED << "\ndox11cmd: Lost the X connection."
+                    << COLOR_NORMAL << "\n";
+                return;
+            }
+        }
 
-    if (format == 32 && nitems >= 1) {
-        if (*(long*) (void*) properties == 1) {
-            result = false;
+        bool isChanged = false;
+        while (XPending(mDisplay)) {
+            XEvent event;
+            XNextEvent(mDisplay, &event);
+            isChanged |= mSnapshot->handleEvent(event);
+        }
+        if (isChanged) {
+            mSnapshot->update();
         }
     }
-
-    XFree(properties);
-    return result;
+    mCommandStatus = 0;
 }
 
 /**
- * This method checks "_NET_WM_STATE" for window HIDDEN.
+ * Supported Commands - move-ws: every matching Window to
+ * workspace N, by _NET_WM_DESKTOP request to the window manager.
+ * All are sent before any is waited for. With ws:M, Windows on
+ * all workspaces are left there.
  */
-bool isNetWM_Hidden(Window window) {
-    bool result = false;
-
-    Atom type;
-    int format;
-    unsigned long nitems, unusedBytes;
-    unsigned char* properties = NULL;
+void doMoveWindowsToWorkspace(const vector<string>& options,
+        OutputWriter& out) {
+    long workspace = 0;
+    char* end = NULL;
+    if (options.size() == 2 && !options[0].empty()) {
+        workspace = strtol(options[0].c_str(), &end, 10);
+    }
+    if (!end || *end) {
+        out << COLOR_RED << "\ndox11cmd: move-ws takes N WINDOW." <<
+            COLOR_NORMAL << "\n";
+        return;
+    }
 
-    XGetWindowProperty(mDisplay, window,
-        XInternAtom(mDisplay, "_NET_WM_STATE", False),
-        0, (~0L), False, AnyPropertyType, &type, &format,
-        &nitems, &unusedBytes, &properties);
+    const vector<Window> windows = getWindowsWithBestName(options[1],
+        true);
+    if (windows.empty()) {
+        out << COLOR_RED << "\ndox11cmd: Cannot find a Window "
+            "by that name." << COLOR_NORMAL << "\n";
+        return;
+    }
 
-    if (format == 32) {
-        for (unsigned long i = 0; i < nitems; i++) {
-            char* nameString = XGetAtomName(mDisplay,
-                ((Atom*) (void*) properties) [i]);
-            if (strcmp(nameString, "_NET_WM_STATE_HIDDEN") == 0) {
-                result = true;
-                XFree(nameString);
-                break;
-            }
-            XFree(nameString);
+    const bool isWorkspaceMatch = options[1].compare(0, 3, "ws:") == 0;
+    for (size_t i = 0; i < windows.size(); i++) {
+        const WinInfo* winInfoItem = mSnapshot->getInfo(
+            mSnapshot->findWindow(windows[i]));
+        if (isWorkspaceMatch && (winInfoItem->ws < 0 ||
+                winInfoItem->sticky)) {
+            continue;
         }
+        mSession->moveToWorkspace(windows[i], workspace);
     }
-
-    XFree(properties);
-    return result;
 }
 
 /**
- * This method checks "WM_STATE" for window HIDDEN attribute.
+ * Supported Commands - move & resize: to X Y, or W H, as list
+ * shows them (the Window, not its frame). With --all, every
+ * match.
  */
-bool isWM_Hidden(Window window) {
-    bool result = false;
+void doMoveResizeWindows(bool isMove, const vector<string>& options,
+        OutputWriter& out) {
+    const bool isAll = !options.empty() && options[0] == "--all";
+    const size_t first = isAll ? 1 : 0;
+
+    long values[2] = { 0, 0 };
+    bool isValid = options.size() == first + 3;
+    for (size_t i = 0; isValid && i < 2; i++) {
+        char* end = NULL;
+        values[i] = strtol(options[first + i].c_str(), &end, 10);
+        isValid = !options[first + i].empty() && *end == '\0' &&
+            (isMove || values[i] > 0);
+    }
+    if (!isValid) {
+        out << COLOR_RED << "\ndox11cmd: " << (isMove ?
+            "move takes X Y WINDOW." : "resize takes W H WINDOW.") <<
+            COLOR_NORMAL << "\n";
+        return;
+    }
+
+    const vector<Window> windows = getWindowsWithBestName(
+        options[first + 2], isAll);
+    if (windows.empty()) {
+        out << COLOR_RED << "\ndox11cmd: Cannot find a Window "
+            "by that name." << COLOR_NORMAL << "\n";
+        return;
+    }
 
-    Atom type;
-    int format;
-    unsigned long nitems, unusedBytes;
-    unsigned char* properties = NULL;
+    LayoutRect rect;
+    rect.x = isMove ? values[0] : 0;
+    rect.y = isMove ? values[1] : 0;
+    rect.w = isMove ? 0 : values[0];
+    rect.h = isMove ? 0 : values[1];
+    for (size_t i = 0; i < windows.size(); i++) {
+        mSession->moveResizeWindow(isMove ? "move" : "resize",
+            windows[i], isMove ? CWX | CWY : CWWidth | CWHeight, rect);
+    }
+}
 
-    XGetWindowProperty(mDisplay, window,
-        XInternAtom(mDisplay, "WM_STATE", False),
-        0, (~0L), False, AnyPropertyType, &type, &format,
-        &nitems, &unusedBytes, &properties);
+/**
+ * Supported Commands - tile: every matching Window, but the
+ * desktop, docks & hidden ones, laid out top-most first in the
+ * current workspace's work area, frames and all. One round trip
+ * reads the frames; every move is sent before any is waited for.
+ */
+void doTileWindows(const vector<string>& options, OutputWriter& out) {
+    LAYOUT layout = LAYOUT_GRID;
+    if (options.size() != 2 || !getLayout(options[0], &layout)) {
+        out << COLOR_RED << "\ndox11cmd: tile takes "
+            "grid|columns|master WINDOW." << COLOR_NORMAL << "\n";
+        return;
+    }
 
-    if (format == 32 && nitems >= 1) {
-        if (*(long*) (void*) properties != NormalState) {
-            result = true;
+    vector<size_t> indexes;
+    {
+        StatsPhase phase(STATS_MATCH);
+        WindowMatcher matcher(options[1]);
+        const vector<size_t> matches = matcher.match(*mSnapshot);
+        for (size_t i = 0; i < matches.size(); i++) {
+            const WinInfo* winInfoItem = mSnapshot->getInfo(matches[i]);
+            if (!winInfoItem->desktop && !winInfoItem->dock &&
+                    !winInfoItem->hidden) {
+                indexes.push_back(matches[i]);
+            }
         }
     }
+    if (indexes.empty()) {
+        out << COLOR_RED << "\ndox11cmd: Cannot find a Window "
+            "by that name." << COLOR_NORMAL << "\n";
+        return;
+    }
 
-    XFree(properties);
-    return result;
+    vector<FrameExtents> frames;
+    LayoutRect workArea;
+    mSnapshot->collectLayoutState(indexes, frames, &workArea);
+
+    const vector<LayoutRect> cells = computeLayout(layout, workArea,
+        indexes.size());
+    for (size_t i = 0; i < indexes.size(); i++) {
+        mSession->moveResizeWindow("tile",
+            mSnapshot->getInfo(indexes[i])->id,
+            CWX | CWY | CWWidth | CWHeight,
+            getClientRect(cells[i], frames[i]));
+    }
 }
 
 /**
- * This method traps and handles X11 errors.
+ * Helper gets the region index of the current snapshot, built
+ * only when the snapshot has changed.
  */
-int handleX11ErrorEvent(Display* dpy, XErrorEvent* event) {
-
-    // Save error & quit early if simply BadWindow.
-    mX11LastErrorCode = event->error_code;
-    if (mX11LastErrorCode == BadWindow) {
-        return 0;
+WindowRegionIndex& getRegionIndex() {
+    if (!mRegionIndex.isBuiltFor(mSnapshot)) {
+        mRegionIndex.build(*mSnapshot);
     }
+    return mRegionIndex;
+}
 
-    // Print the error message of the event.
-    char msg[MAX_ERROR_MESSAGE_LENGTH];
-    XGetErrorText(dpy, event->error_code, msg, sizeof(msg));
+/**
+ * Helper searches for every matching Window Id, top-most first,
+ * or just the best one.
+ */
+vector<Window> getWindowsWithBestName(string name, bool isAll) {
+    StatsPhase phase(STATS_MATCH);
+    WindowMatcher matcher(name);
+
+    vector<Window> windows;
+    const vector<size_t> matches = matcher.match(*mSnapshot);
+    for (size_t i = 0; i < matches.size() && (isAll || i == 0); i++) {
+        windows.push_back(mSnapshot->getInfo(matches[i])->id);
+    }
+    return windows;
+}
 
-    printf("dox11cmd: Error is %s%s%s.\n",
-        COLOR_RED, msg, COLOR_NORMAL);
+/**
+ * Helper opens this thread's session, and points the globals the
+ * verbs use at its parts.
+ */
+void openSession(const char* displayName) {
+    mSession = new Dox11Session(displayName, mBackendName);
+    mDisplayHelper = mSession->getDisplayHelper();
+    mDisplay = mSession->getDisplay();
+    mSnapshot = mSession->getSnapshot();
+}
 
-    return 0;
+/**
+ * Helper waits, once, for every action request, then reports
+ * those that failed by Window, and other errors by request; see
+ * WindowBackend.
+ */
+void syncRequests(OutputWriter& out) {
+    mSession->sync(out);
 }
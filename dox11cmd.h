@@ -5,34 +5,41 @@
  * Small cmdline tool to examine and handle x11 Windows.
  */
 // Std C and c++.
+#include <climits>
+#include <istream>
 #include <string>
+#include <string_view>
+#include <vector>
 
 using namespace std;
 
+// Application.
+#include "dox11Types.h"
+#include "outputWriter.h"
+
 /**
  * Module Types, Enums, & Defines.
  */
-typedef struct {
-        Window id;         // id.
-        long ws;           // workspace.
 
-        bool sticky;       // visible on all workspaces?
-        bool dock;         // is a "dock" (panel)?
-        bool hidden;       // is hidden / iconized?
+// --display=LIST: one per display, each filled by its own worker
+// thread, then merged by main.
+class Dox11Session;
+class WindowSnapshot;
+class WindowRegionIndex;
 
-        int x, y;          // x,y coordinates.
-        int xa, ya;        // x,y coordinates absolute.
-        unsigned int w, h; // width, height.
-} WinInfo;
+typedef struct {
+        string name;
+        vector<string> args;       // VERB & its arguments.
+        Dox11Session* session;
+        WindowSnapshot* snapshot;  // NULL if it could not connect.
+        OutputWriter* out;         // verb output, buffered.
+        OutputWriter* statsOut;    // --stats report, buffered.
+} DisplayContext;
 
-#define COLOR_RED "\033[0;31m"
-#define COLOR_GREEN "\033[1;32m"
-#define COLOR_YELLOW "\033[1;33m"
-#define COLOR_BLUE "\033[1;34m"
-#define COLOR_NORMAL "\033[0m"
+// list: no --ws N.
+#define ALL_WORKSPACES LONG_MIN
 
 #define MAX_TITLE_STRING_LENGTH 40
-#define MAX_ERROR_MESSAGE_LENGTH 60
 
 
 /**
@@ -40,28 +47,51 @@ typedef struct {
  */
 
 // Main init & helpers.
-void doDisplayUseage();
-
-void doListStackedWindowNames();
-void doRaiseWindow(string);
-void doLowerWindow(string);
-void doMapWindow(string);
-void doUnmapWindow(string);
+void doCommand(const vector<string>& args, OutputWriter&);
+void doBatch(istream&, OutputWriter&);
+int doMultiDisplayCommand(const vector<string>& displayNames,
+    const vector<string>& args, bool isStats, OutputWriter&);
+void doDisplayWorker(DisplayContext*, bool isStats);
+void doDisplayUseage(OutputWriter&);
+
+void doListStackedWindowNames(const vector<string>& options,
+    OutputWriter&);
+bool getListWorkspace(const vector<string>& args, long* workspace);
+void writeListHeader(OutputWriter&, bool isTagged);
+void writeListRows(OutputWriter&, const char* display, long workspace,
+    size_t* rowCount);
+void writeListRow(OutputWriter&, const char* display, size_t index,
+    size_t* rowCount);
+void writeListFooter(OutputWriter&);
+void writeListBin(OutputWriter&, long workspace = ALL_WORKSPACES);
+void doRaiseWindow(string, bool isAll, OutputWriter&);
+void doLowerWindow(string, bool isAll, OutputWriter&);
+void doMapWindow(string, bool isAll, OutputWriter&);
+void doUnmapWindow(string, bool isAll, OutputWriter&);
+void doRestackWindows(const vector<string>&, OutputWriter&);
+void doWatchWindows(OutputWriter&);
+void doWindowAt(const vector<string>& point, OutputWriter&);
+void doSnapshot(const vector<string>& options, OutputWriter&);
+int doDiffSnapshots(const vector<string>& paths, OutputWriter&);
+void doMoveWindowsToWorkspace(const vector<string>& options,
+    OutputWriter&);
+void doMoveResizeWindows(bool isMove, const vector<string>& options,
+    OutputWriter&);
+void doTileWindows(const vector<string>& options, OutputWriter&);
+void doCaptureWindows(const vector<string>& options, OutputWriter&);
+void doWaitForWindow(const vector<string>& options, OutputWriter&);
 
 Window getWindowWithBestName(string);
-Window getWindowWithExactName(string name);
-Window getWindowWithPartialName(string name);
-
-unsigned long getX11StackedWindowsList(Window**);
-unsigned long getRootWindowProperty(Atom, Window**);
-long int getWindowWorkspace(Window window);
+vector<Window> getWindowsWithBestName(string, bool isAll);
+WindowRegionIndex& getRegionIndex();
 
-bool isWindow_Sticky(long workSpace, WinInfo*);
-bool isWindow_Dock(WinInfo*);
-bool isWindow_Hidden(Window window, int windowMapState);
+void writeWatchRecords(const vector<WinInfo>& oldInfos,
+    const string& oldTitleArena, Window oldActiveWindow, OutputWriter&);
+void writeWatchAdd(const WinInfo&, string_view title, OutputWriter&);
+bool writeWatchChanges(const WinInfo& oldInfo, string_view oldTitle,
+    const WinInfo&, string_view title, OutputWriter&);
+string getWatchText(string_view);
 
-bool isDesktop_Visible();
-bool isNetWM_Hidden(Window window);
-bool isWM_Hidden(Window window);
+void openSession(const char* displayName);
+void syncRequests(OutputWriter&);
 
-int handleX11ErrorEvent(Display*, XErrorEvent*);
@@ -0,0 +1,306 @@
+/**
+ * Buffered output writer: all verb output goes through one
+ * buffer, written to a file descriptor in large chunks. Numbers
+ * are formatted with to_chars, never locale-aware stdio.
+ */
+
+// Std C and c++.
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+// X11.
+#include <X11/Xlib.h>
+
+// Application.
+#include "dox11Types.h"
+#include "outputWriter.h"
+#include "utf8Helper.h"
+
+
+/**
+ * Module globals.
+ */
+static const char* FORMAT_NAMES[] = { "text", "tsv", "json", "bin" };
+
+
+/**
+ * Module helpers.
+ */
+static bool hasPrefix(const string& text, const char* prefix) {
+    return text.compare(0, strlen(prefix), prefix) == 0;
+}
+
+// Color by default only on a terminal, per https://no-color.org.
+static bool isColorTerminal(int fd) {
+    const char* noColor = getenv("NO_COLOR");
+    const char* term = getenv("TERM");
+    return isatty(fd) && !(noColor && noColor[0]) &&
+        !(term && strcmp(term, "dumb") == 0);
+}
+
+
+/**
+ * Class instantiation.
+ */
+OutputWriter::OutputWriter(int fd) {
+    mFd = fd;
+    mError = 0;
+    mBuffer.reserve(OUTPUT_BUFFER_LENGTH);
+    mIsColor = fd >= 0 && isColorTerminal(fd);
+    mFormat = FORMAT_TEXT;
+}
+
+OutputWriter::~OutputWriter() {
+    flush();
+}
+
+bool OutputWriter::applyOptions(vector<string>& args) {
+    size_t count = 0;
+    for (; count < args.size(); count++) {
+        const string& arg = args[count];
+
+        if (hasPrefix(arg, "--format=")) {
+            const string name = arg.substr(9);
+            size_t format = 0;
+            while (format < 4 && name != FORMAT_NAMES[format]) {
+                format++;
+            }
+            if (format == 4) {
+                *this << COLOR_RED << "\ndox11cmd: FORMAT must be "
+                    "text, tsv, json or bin." << COLOR_NORMAL << "\n";
+                return false;
+            }
+            mFormat = (OUTPUT_FORMAT) format;
+
+        } else if (hasPrefix(arg, "--color=")) {
+            const string when = arg.substr(8);
+            if (when == "always") {
+                mIsColor = true;
+            } else if (when == "never") {
+                mIsColor = false;
+            } else if (when == "auto") {
+                mIsColor = isColorTerminal(mFd);
+            } else {
+                *this << COLOR_RED << "\ndox11cmd: --color must be "
+                    "always, never or auto." << COLOR_NORMAL << "\n";
+                return false;
+            }
+
+        } else {
+            break;
+        }
+    }
+
+    args.erase(args.begin(), args.begin() + count);
+    return true;
+}
+
+/**
+ * The options in effect, resolved, to hand on (e.g. to a daemon
+ * whose output is not this terminal).
+ */
+vector<string> OutputWriter::getOptionArgs() {
+    return {
+        string("--format=") + FORMAT_NAMES[mFormat],
+        mIsColor ? "--color=always" : "--color=never"
+    };
+}
+
+OUTPUT_FORMAT OutputWriter::getFormat() {
+    return mFormat;
+}
+
+bool OutputWriter::isColor() {
+    return mIsColor && mFormat == FORMAT_TEXT;
+}
+
+OutputWriter& OutputWriter::operator<<(const char* text) {
+    if (text[0] == '\033' && text[1] == '[' && !isColor()) {
+        return *this;
+    }
+    write(text, strlen(text));
+    return *this;
+}
+
+OutputWriter& OutputWriter::operator<<(string_view text) {
+    write(text.data(), text.size());
+    return *this;
+}
+
+OutputWriter& OutputWriter::operator<<(char c) {
+    write(&c, 1);
+    return *this;
+}
+
+OutputWriter& OutputWriter::operator<<(int value) {
+    return *this << (long) value;
+}
+
+OutputWriter& OutputWriter::operator<<(unsigned int value) {
+    return *this << (unsigned long) value;
+}
+
+OutputWriter& OutputWriter::operator<<(long value) {
+    char digits[24];
+    const to_chars_result result = to_chars(digits,
+        digits + sizeof(digits), value);
+    write(digits, result.ptr - digits);
+    return *this;
+}
+
+OutputWriter& OutputWriter::operator<<(unsigned long value) {
+    char digits[24];
+    const to_chars_result result = to_chars(digits,
+        digits + sizeof(digits), value);
+    write(digits, result.ptr - digits);
+    return *this;
+}
+
+void OutputWriter::appendNumber(long value, int width,
+        bool isLeftAligned) {
+    char digits[24];
+    const int length = to_chars(digits, digits + sizeof(digits),
+        value).ptr - digits;
+    const int padding = width > length ? width - length : 0;
+
+    if (!isLeftAligned) {
+        mBuffer.append(padding, ' ');
+    }
+    write(digits, length);
+    if (isLeftAligned) {
+        mBuffer.append(padding, ' ');
+    }
+}
+
+void OutputWriter::appendHex(unsigned long value, int digits) {
+    char hex[24];
+    const int length = to_chars(hex, hex + sizeof(hex), value,
+        16).ptr - hex;
+
+    mBuffer += "0x";
+    if (digits > length) {
+        mBuffer.append(digits - length, '0');
+    }
+    write(hex, length);
+}
+
+void OutputWriter::appendJson(string_view text) {
+    appendJsonString(mBuffer, text);
+}
+
+void OutputWriter::write(const void* data, size_t length) {
+    mBuffer.append((const char*) data, length);
+    if (mFd >= 0 && mBuffer.size() >= OUTPUT_BUFFER_LENGTH) {
+        flush();
+    }
+}
+
+bool OutputWriter::flush() {
+    if (mFd < 0) {
+        return true;
+    }
+
+    const char* data = mBuffer.data();
+    size_t length = mBuffer.size();
+
+    while (length > 0 && !mError) {
+        const ssize_t written = ::write(mFd, data, length);
+        if (written < 0) {
+            if (errno != EINTR) {
+                mError = errno;
+            }
+            continue;
+        }
+        data += written;
+        length -= written;
+    }
+
+    mBuffer.clear();
+    return !mError;
+}
+
+int OutputWriter::getError() {
+    return mError;
+}
+
+const string& OutputWriter::getBuffer() {
+    return mBuffer;
+}
+
+/**
+ * Helper reads the process umask, once.
+ */
+static mode_t getUmask() {
+    static const mode_t mask = []() {
+        const mode_t current = umask(0);
+        umask(current);
+        return current;
+    }();
+    return mask;
+}
+
+/**
+ * Write a file whole: to a temporary beside it, renamed over it
+ * once complete, so a reader never sees part of one. It keeps
+ * the mode of the file it replaces, else gets the usual 0666
+ * less umask. False, with a message to "out", if it can't be;
+ * or, with none, if "write" returns false: the file is left as
+ * it was.
+ */
+bool writeFileWhole(const string& path,
+        const function<bool(OutputWriter&)>& write, OutputWriter& out) {
+    string temporaryPath = path + ".XXXXXX";
+    const int fd = mkstemp(&temporaryPath[0]);
+    if (fd < 0) {
+        out << COLOR_RED << "\ndox11cmd: Cannot write " << path <<
+            ": " << strerror(errno) << "." << COLOR_NORMAL << "\n";
+        return false;
+    }
+
+    struct stat oldFile;
+    const mode_t mode = stat(path.c_str(), &oldFile) == 0 ?
+        oldFile.st_mode & 07777 : 0666 & ~getUmask();
+
+    // The first failure, of any write, the mode or the close.
+    int error = 0;
+    bool isComplete;
+    {
+        OutputWriter file(fd);
+        isComplete = write(file);
+        file.flush();
+        error = file.getError();
+    }
+    if (fchmod(fd, mode) != 0 && !error) {
+        error = errno;
+    }
+    if (close(fd) != 0 && !error) {
+        error = errno;
+    }
+    if (!isComplete) {
+        unlink(temporaryPath.c_str());
+        return false;
+    }
+    if (!error && rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        error = errno;
+    }
+
+    if (error) {
+        out << COLOR_RED << "\ndox11cmd: Cannot write " << path <<
+            ": " << strerror(error) << "." << COLOR_NORMAL << "\n";
+        unlink(temporaryPath.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+/**
+ * Buffered output writer: all verb output goes through one
+ * buffer, written to a file descriptor in large chunks. Numbers
+ * are formatted with to_chars, never locale-aware stdio.
+ */
+
+// Std C and c++.
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Module Types, Enums, & Defines.
+ */
+enum OUTPUT_FORMAT {
+    FORMAT_TEXT,
+    FORMAT_TSV,
+    FORMAT_JSON,
+    FORMAT_BIN
+};
+
+#define OUTPUT_BUFFER_LENGTH 65536
+
+/**
+ * Class def.
+ */
+class OutputWriter {
+    public:
+        // fd -1 keeps everything in the buffer, for getBuffer().
+        OutputWriter(int fd);
+        ~OutputWriter();
+
+        // Leading --format=FMT & --color=WHEN args are applied,
+        // then removed. False, with a message, if one is invalid.
+        bool applyOptions(vector<string>& args);
+        vector<string> getOptionArgs();
+
+        OUTPUT_FORMAT getFormat();
+        bool isColor();
+
+        // Text. With color off, COLOR_* sequences are dropped.
+        OutputWriter& operator<<(const char*);
+        OutputWriter& operator<<(string_view);
+        OutputWriter& operator<<(char);
+
+        OutputWriter& operator<<(int);
+        OutputWriter& operator<<(unsigned int);
+        OutputWriter& operator<<(long);
+        OutputWriter& operator<<(unsigned long);
+
+        // Fixed width, padded with SPACE.
+        void appendNumber(long value, int width, bool isLeftAligned);
+        // 0x, then at least "digits" zero padded hex digits.
+        void appendHex(unsigned long value, int digits);
+        // Quoted, escaped, valid UTF-8.
+        void appendJson(string_view);
+
+        void write(const void* data, size_t length);
+        // False once any write has failed, auto-flushes included;
+        // getError() is the first failure's errno.
+        bool flush();
+        int getError();
+        const string& getBuffer();
+
+    private:
+        int mFd;
+        int mError;        // errno of the first failed write, or 0.
+        string mBuffer;
+        bool mIsColor;
+        OUTPUT_FORMAT mFormat;
+};
+
+/**
+ * Module Method stubs.
+ */
+bool writeFileWhole(const string& path,
+    const function<bool(OutputWriter&)>& write, OutputWriter& out);
@@ -0,0 +1,200 @@
+/**
+ * Pixel helpers for Window capture.
+ *
+ * BGRX is a 32 bit little endian pixel with red in bits 16-23,
+ * i.e. the bytes B, G, R, X (or A) in memory; nearly every X
+ * server's TrueColor visual.
+ */
+
+// Std C and c++.
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#define PIXEL_HAS_SSE 1
+#endif
+
+// Application.
+#include "pixelHelper.h"
+
+
+/**
+ * Module helpers.
+ */
+
+static bool isBgrx(const PixelFormat& format) {
+    return format.bitsPerPixel == 32 && !format.isMsbFirst &&
+        format.redMask == 0xff0000 && format.greenMask == 0xff00 &&
+        format.blueMask == 0xff;
+}
+
+// One pixel's value, in the image's byte order.
+static uint32_t readPixel(const PixelFormat& format, const uint8_t* p) {
+    const int bytes = format.bitsPerPixel / 8;
+    uint32_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+        const int shift = format.isMsbFirst ? 8 * (bytes - 1 - i) : 8 * i;
+        value |= (uint32_t) p[i] << shift;
+    }
+    return value;
+}
+
+// A channel, scaled to 8 bits.
+static uint8_t getChannel(uint32_t value, uint32_t mask) {
+    if (!mask) {
+        return 0;
+    }
+    const int shift = __builtin_ctz(mask);
+    const uint32_t maximum = mask >> shift;
+    return (((value & mask) >> shift) * 255 + maximum / 2) / maximum;
+}
+
+static void convertRowGeneric(const PixelFormat& format,
+        const uint8_t* source, uint8_t* target, size_t count,
+        bool isRgba) {
+    const int bytes = format.bitsPerPixel / 8;
+    for (size_t i = 0; i < count; i++) {
+        const uint32_t value = readPixel(format, source + i * bytes);
+        *target++ = getChannel(value, format.redMask);
+        *target++ = getChannel(value, format.greenMask);
+        *target++ = getChannel(value, format.blueMask);
+        if (isRgba) {
+            *target++ = format.hasAlpha ? value >> 24 : 0xff;
+        }
+    }
+}
+
+static void convertBgrxToRgbScalar(const uint8_t* source,
+        uint8_t* target, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        target[0] = source[2];
+        target[1] = source[1];
+        target[2] = source[0];
+        source += 4;
+        target += 3;
+    }
+}
+
+static void convertBgrxToRgbaScalar(const uint8_t* source,
+        uint8_t* target, size_t count, bool hasAlpha) {
+    for (size_t i = 0; i < count; i++) {
+        target[0] = source[2];
+        target[1] = source[1];
+        target[2] = source[0];
+        target[3] = hasAlpha ? source[3] : 0xff;
+        source += 4;
+        target += 4;
+    }
+}
+
+#ifdef PIXEL_HAS_SSE
+// 4 pixels a shuffle; each 16 byte store leaves 4 bytes of slack
+// that the next one overwrites.
+__attribute__((target("ssse3")))
+static void convertBgrxToRgbSsse3(const uint8_t* source,
+        uint8_t* target, size_t count) {
+    const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8,
+        14, 13, 12, -1, -1, -1, -1);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i pixels = _mm_loadu_si128(
+            (const __m128i*) (source + i * 4));
+        _mm_storeu_si128((__m128i*) (target + i * 3),
+            _mm_shuffle_epi8(pixels, shuffle));
+    }
+    convertBgrxToRgbScalar(source + i * 4, target + i * 3, count - i);
+}
+
+__attribute__((target("ssse3")))
+static void convertBgrxToRgbaSsse3(const uint8_t* source,
+        uint8_t* target, size_t count, bool hasAlpha) {
+    const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10,
+        9, 8, 11, 14, 13, 12, 15);
+    const __m128i opaque = _mm_set1_epi32(hasAlpha ? 0 : 0xff000000);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i pixels = _mm_loadu_si128(
+            (const __m128i*) (source + i * 4));
+        _mm_storeu_si128((__m128i*) (target + i * 4), _mm_or_si128(
+            _mm_shuffle_epi8(pixels, shuffle), opaque));
+    }
+    convertBgrxToRgbaScalar(source + i * 4, target + i * 4, count - i,
+        hasAlpha);
+}
+
+// SSE2 has no byte shuffle: swap R & B with shifts & masks.
+static void convertBgrxToRgbaSse2(const uint8_t* source,
+        uint8_t* target, size_t count, bool hasAlpha) {
+    const __m128i greenAlpha = _mm_set1_epi32(hasAlpha ? 0xff00ff00 :
+        0x0000ff00);
+    const __m128i opaque = _mm_set1_epi32(hasAlpha ? 0 : 0xff000000);
+    const __m128i low = _mm_set1_epi32(0xff);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i pixels = _mm_loadu_si128(
+            (const __m128i*) (source + i * 4));
+        const __m128i red = _mm_and_si128(_mm_srli_epi32(pixels, 16),
+            low);
+        const __m128i blue = _mm_slli_epi32(_mm_and_si128(pixels, low),
+            16);
+        const __m128i rgba = _mm_or_si128(_mm_or_si128(red, blue),
+            _mm_or_si128(_mm_and_si128(pixels, greenAlpha), opaque));
+        _mm_storeu_si128((__m128i*) (target + i * 4), rgba);
+    }
+    convertBgrxToRgbaScalar(source + i * 4, target + i * 4, count - i,
+        hasAlpha);
+}
+
+static bool isSsse3() {
+    static const bool isSupported = __builtin_cpu_supports("ssse3");
+    return isSupported;
+}
+#endif
+
+
+/**
+ * A row of "count" pixels to packed RGB, 3 bytes each. "target"
+ * needs PIXEL_ROW_SLACK bytes past the row.
+ */
+void convertRowToRgb(const PixelFormat& format, const uint8_t* source,
+        uint8_t* target, size_t count) {
+    if (!isBgrx(format)) {
+        convertRowGeneric(format, source, target, count, false);
+        return;
+    }
+
+#ifdef PIXEL_HAS_SSE
+    if (isSsse3()) {
+        convertBgrxToRgbSsse3(source, target, count);
+        return;
+    }
+#endif
+    convertBgrxToRgbScalar(source, target, count);
+}
+
+/**
+ * A row of "count" pixels to RGBA, 4 bytes each; alpha is opaque
+ * unless the format has it.
+ */
+void convertRowToRgba(const PixelFormat& format, const uint8_t* source,
+        uint8_t* target, size_t count) {
+    if (!isBgrx(format)) {
+        convertRowGeneric(format, source, target, count, true);
+        return;
+    }
+
+#ifdef PIXEL_HAS_SSE
+    if (isSsse3()) {
+        convertBgrxToRgbaSsse3(source, target, count, format.hasAlpha);
+    } else {
+        convertBgrxToRgbaSse2(source, target, count, format.hasAlpha);
+    }
+#else
+    convertBgrxToRgbaScalar(source, target, count, format.hasAlpha);
+#endif
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+/**
+ * Pixel helpers for Window capture: rows of X image pixels to RGB
+ * (PPM) or RGBA. The common 32 bit BGRX layout has SSSE3 & SSE2
+ * paths, chosen once at run time; anything else is converted by
+ * its channel masks.
+ */
+
+// Std C and c++.
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+/**
+ * Module Types, Enums, & Defines.
+ */
+
+// Bytes past a converted row's end that may be written; SIMD
+// stores whole 16 byte blocks.
+#define PIXEL_ROW_SLACK 16
+
+// One pixel format: bits per pixel, channel masks & byte order.
+typedef struct {
+        int bitsPerPixel;  // 8, 16, 24 or 32.
+        bool isMsbFirst;
+        uint32_t redMask, greenMask, blueMask;
+        bool hasAlpha;     // depth 32: the top byte is alpha.
+} PixelFormat;
+
+/**
+ * Module Method stubs.
+ */
+void convertRowToRgb(const PixelFormat&, const uint8_t* source,
+    uint8_t* target, size_t count);
+void convertRowToRgba(const PixelFormat&, const uint8_t* source,
+    uint8_t* target, size_t count);
@@ -0,0 +1,74 @@
+/**
+ * Replay window backend: actions are counted, never sent.
+ */
+
+// X11.
+#include <X11/Xlib.h>
+
+// Application.
+#include "replayBackend.h"
+#include "xStats.h"
+#include "xTrace.h"
+
+
+/**
+ * Class instantiation.
+ */
+ReplayBackend::ReplayBackend(xDisplayHelper* displayHelper) :
+        WindowBackend(displayHelper) {
+    mSerial = 0;
+}
+
+const char* ReplayBackend::getName() {
+    return "replay";
+}
+
+void ReplayBackend::trackRequest(const char* verb, Window window,
+        const char* name) {
+    statsCountCall(name);
+    mTrackedRequests.push_back({ ++mSerial, verb, window, 0 });
+}
+
+void ReplayBackend::raiseWindow(const char* verb, Window window) {
+    trackRequest(verb, window, "ConfigureWindow");
+}
+
+void ReplayBackend::lowerWindow(const char* verb, Window window) {
+    trackRequest(verb, window, "ConfigureWindow");
+}
+
+void ReplayBackend::mapWindow(const char* verb, Window window) {
+    trackRequest(verb, window, "MapWindow");
+}
+
+void ReplayBackend::unmapWindow(const char* verb, Window window) {
+    trackRequest(verb, window, "UnmapWindow");
+}
+
+void ReplayBackend::restackWindow(const char* verb, Window window,
+        Window, int) {
+    trackRequest(verb, window, "ConfigureWindow");
+}
+
+void ReplayBackend::configureWindow(const char* verb, Window window,
+        unsigned int, int, int, unsigned int, unsigned int) {
+    trackRequest(verb, window, "ConfigureWindow");
+}
+
+void ReplayBackend::sendRootMessage(const char* verb, Window window,
+        Atom, const long[5]) {
+    trackRequest(verb, window, "SendEvent");
+}
+
+void ReplayBackend::flush() {
+}
+
+void ReplayBackend::sync() {
+    statsCountCall("GetInputFocus");
+    statsCountRoundTrip(32);
+    traceSleep();
+}
+
+void ReplayBackend::syncTrackedRequests() {
+    sync();
+}
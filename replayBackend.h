@@ -0,0 +1,47 @@
+#pragma once
+
+/**
+ * Replay window backend: with --replay there is no X server, so
+ * actions are only counted, as if each had succeeded. A sync
+ * costs the injected --latency, as a round trip would.
+ */
+
+// X11.
+#include <X11/Xlib.h>
+
+// Application.
+#include "windowBackend.h"
+#include "xDisplayHelper.h"
+
+/**
+ * Class def.
+ */
+class ReplayBackend : public WindowBackend {
+    public:
+        ReplayBackend(xDisplayHelper*);
+
+        const char* getName();
+
+        void raiseWindow(const char* verb, Window);
+        void lowerWindow(const char* verb, Window);
+        void mapWindow(const char* verb, Window);
+        void unmapWindow(const char* verb, Window);
+        void restackWindow(const char* verb, Window, Window sibling,
+            int stackMode);
+        void configureWindow(const char* verb, Window,
+            unsigned int valueMask, int x, int y, unsigned int width,
+            unsigned int height);
+        void sendRootMessage(const char* verb, Window,
+            Atom messageType, const long data[5]);
+
+        void flush();
+        void sync();
+
+    protected:
+        void syncTrackedRequests();
+
+    private:
+        void trackRequest(const char* verb, Window, const char* name);
+
+        unsigned long mSerial;
+};
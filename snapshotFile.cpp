@@ -0,0 +1,164 @@
+/**
+ * Snapshot file: a list --format=bin stream saved to a file,
+ * mapped read-only and used in place.
+ *
+ * Files are written beside their final name, then renamed over
+ * it, so a reader never maps a partly written one.
+ */
+
+// Std C and c++.
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace std;
+
+// X11.
+#include <X11/Xlib.h>
+
+// Application.
+#include "dox11cmd.h"
+#include "outputWriter.h"
+#include "snapshotFile.h"
+
+
+/**
+ * Class instantiation.
+ */
+SnapshotFile::SnapshotFile() {
+    mData = NULL;
+    mLength = 0;
+    mHeader = NULL;
+    mRecords = NULL;
+    mTitleArena = NULL;
+}
+
+SnapshotFile::~SnapshotFile() {
+    if (mData) {
+        munmap(mData, mLength);
+    }
+}
+
+/**
+ * Map a file, and check its header & sizes against its length.
+ */
+bool SnapshotFile::open(const string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        mError = path + ": " + strerror(errno);
+        return false;
+    }
+
+    struct stat status;
+    if (fstat(fd, &status) != 0 ||
+            (size_t) status.st_size < sizeof(WinInfoStreamHeader)) {
+        mError = path + ": Not a snapshot file";
+        close(fd);
+        return false;
+    }
+
+    mLength = status.st_size;
+    mData = mmap(NULL, mLength, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mData == MAP_FAILED) {
+        mData = NULL;
+        mError = path + ": " + strerror(errno);
+        return false;
+    }
+
+    // Native byte order only; a foreign one fails the magic test.
+    mHeader = (const WinInfoStreamHeader*) mData;
+    if (mHeader->magic != WIN_INFO_STREAM_MAGIC) {
+        mError = path + ": Not a snapshot file, or another byte order";
+        return false;
+    }
+    if (mHeader->version != WIN_INFO_STREAM_VERSION ||
+            mHeader->recordSize != sizeof(WinInfoRecord)) {
+        mError = path + ": Unsupported snapshot version " +
+            to_string(mHeader->version);
+        return false;
+    }
+
+    const size_t recordsLength = (size_t) mHeader->count *
+        sizeof(WinInfoRecord);
+    if (sizeof(WinInfoStreamHeader) + recordsLength +
+            mHeader->titleArenaLength != mLength) {
+        mError = path + ": Truncated snapshot file";
+        return false;
+    }
+
+    mRecords = (const WinInfoRecord*) (mHeader + 1);
+    mTitleArena = (const char*) (mRecords + mHeader->count);
+    return true;
+}
+
+const string& SnapshotFile::getError() {
+    return mError;
+}
+
+size_t SnapshotFile::size() {
+    return mRecords ? mHeader->count : 0;
+}
+
+const WinInfoRecord* SnapshotFile::getRecord(size_t index) {
+    return &mRecords[index];
+}
+
+/**
+ * A record as a WinInfo; its title offset is into this file's
+ * title arena.
+ */
+WinInfo SnapshotFile::getInfo(size_t index) {
+    const WinInfoRecord* record = &mRecords[index];
+
+    WinInfo winInfoItem;
+    winInfoItem.id = record->id;
+    winInfoItem.ws = record->ws;
+    winInfoItem.pid = record->pid;
+    winInfoItem.sticky = record->flags & WIN_INFO_STICKY;
+    winInfoItem.dock = record->flags & WIN_INFO_DOCK;
+    winInfoItem.desktop = record->flags & WIN_INFO_DESKTOP;
+    winInfoItem.hidden = record->flags & WIN_INFO_HIDDEN;
+    winInfoItem.x = record->x;
+    winInfoItem.y = record->y;
+    winInfoItem.xa = record->xa;
+    winInfoItem.ya = record->ya;
+    winInfoItem.w = record->w;
+    winInfoItem.h = record->h;
+    winInfoItem.titleOffset = record->titleOffset;
+    winInfoItem.titleLength = record->titleLength;
+    return winInfoItem;
+}
+
+/**
+ * A record's title, clipped to the arena should the record be bad.
+ */
+string_view SnapshotFile::getTitle(size_t index) {
+    const WinInfoRecord* record = &mRecords[index];
+    const size_t arenaLength = mHeader->titleArenaLength;
+    const size_t offset = record->titleOffset < arenaLength ?
+        record->titleOffset : arenaLength;
+    const size_t length = record->titleLength < arenaLength - offset ?
+        record->titleLength : arenaLength - offset;
+    return string_view(mTitleArena + offset, length);
+}
+
+
+/**
+ * Write the current snapshot to a file, as list --format=bin
+ * does, replacing it whole. False, with a message to "out", on
+ * failure.
+ */
+bool writeSnapshotFile(const string& path, OutputWriter& out) {
+    return writeFileWhole(path, [](OutputWriter& file) {
+        writeListBin(file);
+        return true;
+    }, out);
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+/**
+ * Snapshot file: a list --format=bin stream (see WinInfoRecord in
+ * dox11Types.h) saved to a file, mapped read-only and used in place.
+ * Records are read straight from the mapping, never parsed.
+ */
+
+// Std C and c++.
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+// Application.
+#include "dox11Types.h"
+
+/**
+ * Class def.
+ */
+class SnapshotFile {
+    public:
+        SnapshotFile();
+        ~SnapshotFile();
+
+        // False, with getError(), if missing or not a valid stream.
+        bool open(const string& path);
+        const string& getError();
+
+        // Top-most first, as written.
+        size_t size();
+        const WinInfoRecord* getRecord(size_t index);
+        WinInfo getInfo(size_t index);
+        string_view getTitle(size_t index);
+
+    private:
+        void* mData;
+        size_t mLength;
+        string mError;
+
+        const WinInfoStreamHeader* mHeader;
+        const WinInfoRecord* mRecords;
+        const char* mTitleArena;
+};
+
+/**
+ * Module Method stubs.
+ */
+bool writeSnapshotFile(const string& path, OutputWriter& out);
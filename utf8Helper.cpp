@@ -0,0 +1,224 @@
+/**
+ * UTF-8 text helpers for Window titles.
+ *
+ * Display widths follow the usual wcwidth() rules (combining marks
+ * are zero wide, East Asian wide & emoji are two), without
+ * depending on the process locale.
+ */
+
+// Std C and c++.
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+// Application.
+#include "utf8Helper.h"
+
+
+/**
+ * Module Types, Enums, & Defines.
+ */
+typedef struct {
+    uint32_t first;
+    uint32_t last;
+} CodeRange;
+
+static const CodeRange ZERO_WIDTH_RANGES[] = {
+    { 0x0300, 0x036F }, { 0x0483, 0x0489 }, { 0x0591, 0x05BD },
+    { 0x0610, 0x061A }, { 0x064B, 0x065F }, { 0x0E31, 0x0E31 },
+    { 0x0E34, 0x0E3A }, { 0x0E47, 0x0E4E }, { 0x1AB0, 0x1AFF },
+    { 0x1DC0, 0x1DFF }, { 0x200B, 0x200F }, { 0x202A, 0x202E },
+    { 0x2060, 0x2064 }, { 0x20D0, 0x20FF }, { 0xFE00, 0xFE0F },
+    { 0xFE20, 0xFE2F }, { 0xFEFF, 0xFEFF }
+};
+
+static const CodeRange WIDE_RANGES[] = {
+    { 0x1100, 0x115F }, { 0x2E80, 0x303E }, { 0x3041, 0x33FF },
+    { 0x3400, 0x4DBF }, { 0x4E00, 0x9FFF }, { 0xA000, 0xA4CF },
+    { 0xAC00, 0xD7A3 }, { 0xF900, 0xFAFF }, { 0xFE30, 0xFE4F },
+    { 0xFF00, 0xFF60 }, { 0xFFE0, 0xFFE6 }, { 0x1F300, 0x1F64F },
+    { 0x1F900, 0x1F9FF }, { 0x20000, 0x2FFFD }, { 0x30000, 0x3FFFD }
+};
+
+
+/**
+ * Module helpers.
+ */
+static bool isInRanges(uint32_t codePoint, const CodeRange* ranges,
+        size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (codePoint >= ranges[i].first && codePoint <= ranges[i].last) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Decode one code point at text[*position], advancing past it.
+ * Malformed input decodes as U+FFFD, one byte at a time: bad
+ * sequences, overlong forms, surrogates & past U+10FFFF.
+ */
+static uint32_t decodeUtf8(string_view text, size_t* position) {
+    const unsigned char lead = text[*position];
+
+    if (lead < 0x80) {
+        (*position)++;
+        return lead;
+    }
+
+    int length = 0;
+    uint32_t codePoint = 0;
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        length = 2;
+        codePoint = lead & 0x1F;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        length = 3;
+        codePoint = lead & 0x0F;
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        length = 4;
+        codePoint = lead & 0x07;
+    }
+
+    if (length == 0 || *position + length > text.size()) {
+        (*position)++;
+        return 0xFFFD;
+    }
+    for (int i = 1; i < length; i++) {
+        const unsigned char next = text[*position + i];
+        if ((next & 0xC0) != 0x80) {
+            (*position)++;
+            return 0xFFFD;
+        }
+        codePoint = (codePoint << 6) | (next & 0x3F);
+    }
+
+    static const uint32_t MIN_CODE_POINTS[] = { 0, 0, 0x80, 0x800, 0x10000 };
+    if (codePoint < MIN_CODE_POINTS[length] || codePoint > 0x10FFFF ||
+            (codePoint >= 0xD800 && codePoint <= 0xDFFF)) {
+        (*position)++;
+        return 0xFFFD;
+    }
+
+    *position += length;
+    return codePoint;
+}
+
+
+/**
+ * Append ISO-8859-1 text (STRING type properties) as UTF-8.
+ */
+void appendLatin1AsUtf8(string& out, const char* text, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        const unsigned char c = text[i];
+        if (c < 0x80) {
+            out += (char) c;
+        } else {
+            out += (char) (0xC0 | (c >> 6));
+            out += (char) (0x80 | (c & 0x3F));
+        }
+    }
+}
+
+/**
+ * Display columns taken by one code point; -1 if unprintable.
+ */
+int getDisplayWidth(uint32_t codePoint) {
+    if (codePoint < 0x20 || (codePoint >= 0x7F && codePoint < 0xA0)) {
+        return -1;
+    }
+    if (codePoint < 0x0300) {
+        return 1;
+    }
+    if (isInRanges(codePoint, ZERO_WIDTH_RANGES,
+            sizeof(ZERO_WIDTH_RANGES) / sizeof(CodeRange))) {
+        return 0;
+    }
+    if (isInRanges(codePoint, WIDE_RANGES,
+            sizeof(WIDE_RANGES) / sizeof(CodeRange))) {
+        return 2;
+    }
+    return 1;
+}
+
+/**
+ * Append UTF-8 text as exactly "columns" display columns:
+ * truncated, unprintables replaced with SPACE, padded right
+ * with SPACE.
+ */
+void appendFixedWidth(string& out, string_view text, int columns) {
+    int used = 0;
+    size_t position = 0;
+
+    // ASCII fast path, byte per column.
+    while (position < text.size() && used < columns) {
+        const unsigned char c = text[position];
+        if (c >= 0x80) {
+            break;
+        }
+        out += (c >= 0x20 && c < 0x7F) ? (char) c : ' ';
+        position++;
+        used++;
+    }
+
+    while (position < text.size() && used < columns) {
+        const size_t start = position;
+        const uint32_t codePoint = decodeUtf8(text, &position);
+        const int width = getDisplayWidth(codePoint);
+
+        if (width < 0) {
+            out += ' ';
+            used++;
+        } else if (used + width > columns) {
+            break;
+        } else if (codePoint == 0xFFFD) {
+            out += '?';
+            used++;
+        } else {
+            out.append(text, start, position - start);
+            used += width;
+        }
+    }
+
+    out.append(columns - used, ' ');
+}
+
+/**
+ * Append text as a quoted JSON string: '"', '\\' & controls
+ * escaped, malformed UTF-8 replaced with U+FFFD.
+ */
+void appendJsonString(string& out, string_view text) {
+    static const char HEX[] = "0123456789abcdef";
+
+    out += '"';
+    size_t position = 0;
+    while (position < text.size()) {
+        const unsigned char c = text[position];
+
+        if (c >= 0x80) {
+            const size_t start = position;
+            if (decodeUtf8(text, &position) == 0xFFFD &&
+                    position - start == 1) {
+                out += "\xEF\xBF\xBD"; // U+FFFD.
+            } else {
+                out.append(text, start, position - start);
+            }
+            continue;
+        }
+
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += (char) c;
+        } else if (c < 0x20) {
+            out += "\\u00";
+            out += HEX[c >> 4];
+            out += HEX[c & 0x0F];
+        } else {
+            out += (char) c;
+        }
+        position++;
+    }
+    out += '"';
+}
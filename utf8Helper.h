@@ -0,0 +1,21 @@
+#pragma once
+
+/**
+ * UTF-8 text helpers for Window titles.
+ */
+
+// Std C and c++.
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+/**
+ * Module Method stubs.
+ */
+void appendLatin1AsUtf8(string& out, const char* text, size_t length);
+void appendFixedWidth(string& out, string_view text, int columns);
+void appendJsonString(string& out, string_view text);
+
+int getDisplayWidth(uint32_t codePoint);
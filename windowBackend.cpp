@@ -0,0 +1,132 @@
+/**
+ * Window backend: the requests that act on Windows, behind one
+ * interface, and the per-Window error reporting they share.
+ */
+
+// Std C and c++.
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// X11.
+#include <X11/Xlib.h>
+
+// Application.
+#include "dox11Types.h"
+#include "outputWriter.h"
+#include "replayBackend.h"
+#include "windowBackend.h"
+#include "xcbBackend.h"
+#include "xlibBackend.h"
+#include "xDisplayHelper.h"
+
+
+/**
+ * Class instantiation.
+ */
+WindowBackend::WindowBackend(xDisplayHelper* displayHelper) {
+    mDisplayHelper = displayHelper;
+}
+
+WindowBackend::~WindowBackend() {
+}
+
+/**
+ * Errors are matched to requests by sequence number, so any
+ * number of requests cost one round trip.
+ */
+void WindowBackend::syncRequests(vector<TrackedRequest>& failures,
+        vector<UntrackedError>& errors) {
+    if (!mTrackedRequests.empty()) {
+        syncTrackedRequests();
+    }
+
+    for (size_t i = 0; i < mTrackedRequests.size(); i++) {
+        if (mTrackedRequests[i].errorCode) {
+            failures.push_back(mTrackedRequests[i]);
+        }
+    }
+    mTrackedRequests.clear();
+
+    errors.insert(errors.end(), mUntrackedErrors.begin(),
+        mUntrackedErrors.end());
+    mUntrackedErrors.clear();
+}
+
+void WindowBackend::syncRequests(OutputWriter& out) {
+    vector<TrackedRequest> failures;
+    vector<UntrackedError> errors;
+    syncRequests(failures, errors);
+    Display* display = mDisplayHelper->getDisplay();
+
+    for (size_t i = 0; i < failures.size(); i++) {
+        const TrackedRequest& request = failures[i];
+
+        char message[MAX_ERROR_MESSAGE_LENGTH] = "";
+        XGetErrorText(display, request.errorCode, message,
+            sizeof(message));
+        out << COLOR_RED << "dox11cmd: Cannot " << request.verb <<
+            " Window ";
+        out.appendHex(request.window, 8);
+        out << ": " << message << "." << COLOR_NORMAL << "\n";
+    }
+
+    // The rest, by request name (X_GetImage, ...) & resource.
+    for (size_t i = 0; i < errors.size(); i++) {
+        const UntrackedError& error = errors[i];
+
+        char number[16];
+        snprintf(number, sizeof(number), "%d", error.requestCode);
+        char request[MAX_ERROR_MESSAGE_LENGTH] = "";
+        XGetErrorDatabaseText(display, "XRequest", number, number,
+            request, sizeof(request));
+        char message[MAX_ERROR_MESSAGE_LENGTH] = "";
+        XGetErrorText(display, error.errorCode, message,
+            sizeof(message));
+
+        out << COLOR_RED << "dox11cmd: " << request << " on ";
+        out.appendHex(error.resource, 8);
+        out << ": " << message << "." << COLOR_NORMAL << "\n";
+    }
+}
+
+/**
+ * Serials are tracked in increasing order.
+ */
+bool WindowBackend::recordError(unsigned long serial, int errorCode) {
+    auto request = lower_bound(mTrackedRequests.begin(),
+        mTrackedRequests.end(), serial,
+        [](const TrackedRequest& tracked, unsigned long serial) {
+            return tracked.serial < serial;
+        });
+    if (request == mTrackedRequests.end() || request->serial != serial) {
+        return false;
+    }
+
+    request->errorCode = errorCode;
+    return true;
+}
+
+void WindowBackend::recordUntrackedError(int requestCode,
+        unsigned long resource, int errorCode) {
+    mUntrackedErrors.push_back({ requestCode, resource, errorCode });
+}
+
+
+bool isWindowBackendName(const string& name) {
+    return name == "xlib" || name == "xcb";
+}
+
+WindowBackend* createWindowBackend(const string& name,
+        xDisplayHelper* displayHelper) {
+    if (name == "xcb") {
+        return new XcbBackend(displayHelper);
+    }
+    if (name == "replay") {
+        return new ReplayBackend(displayHelper);
+    }
+    return new XlibBackend(displayHelper);
+}
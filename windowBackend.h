@@ -0,0 +1,110 @@
+#pragma once
+
+/**
+ * Window backend: the requests that act on Windows, behind one
+ * interface, so verbs don't care which X library sends them.
+ *
+ *    xlib   Xlib, on the Display connection (default)
+ *    xcb    XCB checked requests, on the connection the snapshot
+ *           queries already use
+ *    replay none sent; for --replay, with no X server
+ *
+ * Every action names the verb it is for. A request that fails
+ * is reported against its Window by syncRequests(), as is any
+ * other error, by request, that arrived before it.
+ */
+
+// Std C and c++.
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// X11.
+#include <X11/Xlib.h>
+
+// Application.
+#include "outputWriter.h"
+#include "xDisplayHelper.h"
+
+/**
+ * Module Types, Enums, & Defines.
+ */
+
+// A request acting on a Window, found again by sequence number if
+// it fails.
+typedef struct {
+        unsigned long serial;
+        const char* verb;
+        Window window;
+        int errorCode;     // 0 until an error arrives.
+} TrackedRequest;
+
+// An error no tracked request owns, by the request that caused it.
+typedef struct {
+        int requestCode;   // major opcode.
+        unsigned long resource;
+        int errorCode;
+} UntrackedError;
+
+/**
+ * Class def.
+ */
+class WindowBackend {
+    public:
+        WindowBackend(xDisplayHelper*);
+        virtual ~WindowBackend();
+
+        virtual const char* getName() = 0;
+
+        // Queued, not waited for.
+        virtual void raiseWindow(const char* verb, Window) = 0;
+        virtual void lowerWindow(const char* verb, Window) = 0;
+        virtual void mapWindow(const char* verb, Window) = 0;
+        virtual void unmapWindow(const char* verb, Window) = 0;
+        virtual void restackWindow(const char* verb, Window,
+            Window sibling, int stackMode) = 0;
+
+        // Position & size, as valueMask's CWX, CWY, CWWidth and
+        // CWHeight bits ask.
+        virtual void configureWindow(const char* verb, Window,
+            unsigned int valueMask, int x, int y, unsigned int width,
+            unsigned int height) = 0;
+        virtual void sendRootMessage(const char* verb, Window,
+            Atom messageType, const long data[5]) = 0;
+
+        virtual void flush() = 0;
+        virtual void sync() = 0;
+
+        // One wait for every tracked request, then failures, by
+        // Window, to "out". No wait if nothing is tracked.
+        void syncRequests(OutputWriter& out);
+
+        // The same, with the failed requests and other errors
+        // added to "failures" and "errors".
+        void syncRequests(vector<TrackedRequest>& failures,
+            vector<UntrackedError>& errors);
+
+        // For an error handler: note an error against a tracked
+        // request. False if the serial isn't one.
+        bool recordError(unsigned long serial, int errorCode);
+
+        // For an error handler: keep any other error, to report
+        // with the next syncRequests().
+        void recordUntrackedError(int requestCode,
+            unsigned long resource, int errorCode);
+
+    protected:
+        virtual void syncTrackedRequests() = 0;
+
+        xDisplayHelper* mDisplayHelper;
+        vector<TrackedRequest> mTrackedRequests;
+        vector<UntrackedError> mUntrackedErrors;
+};
+
+/**
+ * Module Method stubs.
+ */
+bool isWindowBackendName(const string& name);
+WindowBackend* createWindowBackend(const string& name,
+    xDisplayHelper*);
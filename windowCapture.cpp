@@ -0,0 +1,218 @@
+/**
+ * Window capture: MIT-SHM, else XGetImage, then PPM or raw RGBA.
+ */
+
+// Std C and c++.
+#include <vector>
+
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+using namespace std;
+
+// X11.
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+
+// Application.
+#include "dox11Types.h"
+#include "outputWriter.h"
+#include "pixelHelper.h"
+#include "windowCapture.h"
+#include "xStats.h"
+
+/**
+ * Module Types, Enums, & Defines.
+ */
+
+// Segments grow in whole steps, so a run of captures of similar
+// Windows attaches once.
+#define SEGMENT_STEP (4 << 20)
+
+
+/**
+ * Class instantiation.
+ */
+WindowCapture::WindowCapture(xDisplayHelper* displayHelper) {
+    mDisplay = displayHelper->getDisplay();
+    mIsSharedMemory = mDisplay && XShmQueryExtension(mDisplay);
+    mSegmentSize = 0;
+    mImage = NULL;
+    mIsImageShared = false;
+}
+
+WindowCapture::~WindowCapture() {
+    releaseImage();
+    releaseSegment();
+}
+
+bool WindowCapture::isSharedMemory() {
+    return mIsSharedMemory;
+}
+
+/**
+ * Shared memory first. If it fails where XGetImage then works,
+ * it's the display that can't share (not the Window), so it
+ * isn't tried again.
+ */
+XImage* WindowCapture::capture(Window window, int depth,
+        unsigned long visual, const LayoutRect& rect) {
+    releaseImage();
+
+    Visual* windowVisual = findVisual(visual);
+    bool isSharedFailed = false;
+    if (mIsSharedMemory && windowVisual && depth) {
+        XImage* image = XShmCreateImage(mDisplay, windowVisual, depth,
+            ZPixmap, NULL, &mSegment, rect.w, rect.h);
+        if (image && reserveSegment(image->bytes_per_line *
+                image->height)) {
+            image->data = mSegment.shmaddr;
+
+            statsCountCall("XShmGetImage");
+            const bool isRead = XShmGetImage(mDisplay, window, image,
+                rect.x, rect.y, AllPlanes);
+            statsCountRoundTrip(32);
+            if (isRead) {
+                mImage = image;
+                mIsImageShared = true;
+                return mImage;
+            }
+            isSharedFailed = true;
+        }
+        if (image) {
+            image->data = NULL;
+            XDestroyImage(image);
+        }
+    }
+
+    statsCountCall("XGetImage");
+    mImage = XGetImage(mDisplay, window, rect.x, rect.y, rect.w, rect.h,
+        AllPlanes, ZPixmap);
+    if (!mImage) {
+        statsCountRoundTrip(32);
+        return NULL;
+    }
+    statsCountRoundTrip(32 + mImage->bytes_per_line * mImage->height);
+
+    if (isSharedFailed) {
+        mIsSharedMemory = false;
+    }
+    return mImage;
+}
+
+/**
+ * A VisualID's Visual, from the display's list; no round trip.
+ */
+Visual* WindowCapture::findVisual(unsigned long visual) {
+    XVisualInfo templateInfo;
+    templateInfo.visualid = visual;
+
+    int count = 0;
+    XVisualInfo* info = XGetVisualInfo(mDisplay, VisualIDMask,
+        &templateInfo, &count);
+    Visual* result = info && count > 0 ? info->visual : NULL;
+    if (info) {
+        XFree(info);
+    }
+    return result;
+}
+
+/**
+ * A segment of at least "size", attached by both sides. It is
+ * marked for removal as soon as the server has it, so nothing is
+ * left behind, however this process ends.
+ */
+bool WindowCapture::reserveSegment(size_t size) {
+    if (size <= mSegmentSize) {
+        return true;
+    }
+    releaseSegment();
+
+    size = (size + SEGMENT_STEP - 1) / SEGMENT_STEP * SEGMENT_STEP;
+    mSegment.shmid = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+    if (mSegment.shmid < 0) {
+        mIsSharedMemory = false;
+        return false;
+    }
+    mSegment.shmaddr = (char*) shmat(mSegment.shmid, NULL, 0);
+    if (mSegment.shmaddr == (char*) -1) {
+        shmctl(mSegment.shmid, IPC_RMID, NULL);
+        mIsSharedMemory = false;
+        return false;
+    }
+    mSegment.readOnly = False;
+
+    statsCountCall("XShmAttach");
+    XShmAttach(mDisplay, &mSegment);
+    statsCountCall("XSync");
+    XSync(mDisplay, False);
+    statsCountRoundTrip(32);
+
+    shmctl(mSegment.shmid, IPC_RMID, NULL);
+    mSegmentSize = size;
+    return true;
+}
+
+void WindowCapture::releaseSegment() {
+    if (!mSegmentSize) {
+        return;
+    }
+
+    statsCountCall("XShmDetach");
+    XShmDetach(mDisplay, &mSegment);
+    shmdt(mSegment.shmaddr);
+    mSegmentSize = 0;
+}
+
+void WindowCapture::releaseImage() {
+    if (!mImage) {
+        return;
+    }
+
+    // The segment outlives its images.
+    if (mIsImageShared) {
+        mImage->data = NULL;
+    }
+    XDestroyImage(mImage);
+    mImage = NULL;
+    mIsImageShared = false;
+}
+
+
+/**
+ * Write a captured image as binary PPM (P6), or as raw RGBA rows
+ * with no header. False if its pixels aren't whole bytes.
+ */
+bool writeCaptureImage(OutputWriter& out, XImage* image, bool isRgba) {
+    if (image->bits_per_pixel % 8 || image->bits_per_pixel > 32) {
+        return false;
+    }
+
+    PixelFormat format;
+    format.bitsPerPixel = image->bits_per_pixel;
+    format.isMsbFirst = image->byte_order == MSBFirst;
+    format.redMask = image->red_mask;
+    format.greenMask = image->green_mask;
+    format.blueMask = image->blue_mask;
+    format.hasAlpha = image->depth == 32;
+
+    const size_t channels = isRgba ? 4 : 3;
+    if (!isRgba) {
+        out << "P6\n" << image->width << ' ' << image->height <<
+            "\n255\n";
+    }
+
+    vector<uint8_t> row(image->width * channels + PIXEL_ROW_SLACK);
+    for (int y = 0; y < image->height; y++) {
+        const uint8_t* source = (const uint8_t*) image->data +
+            (size_t) y * image->bytes_per_line;
+        if (isRgba) {
+            convertRowToRgba(format, source, row.data(), image->width);
+        } else {
+            convertRowToRgb(format, source, row.data(), image->width);
+        }
+        out.write(row.data(), image->width * channels);
+    }
+    return true;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+/**
+ * Window capture: a Window's pixels, read by MIT-SHM into one
+ * shared memory segment kept (and grown) across captures, so the
+ * image never crosses the socket. Where shared memory can't be
+ * used (a remote display), XGetImage copies it instead.
+ */
+
+// X11.
+#include <X11/Xlib.h>
+#include <X11/extensions/XShm.h>
+
+// Application.
+#include "dox11Types.h"
+#include "outputWriter.h"
+#include "xDisplayHelper.h"
+
+/**
+ * Class def.
+ */
+class WindowCapture {
+    public:
+        WindowCapture(xDisplayHelper*);
+        ~WindowCapture();
+
+        // The pixels within "rect", in Window coordinates, valid
+        // until the next capture. NULL if they can't be read.
+        XImage* capture(Window, int depth, unsigned long visual,
+            const LayoutRect& rect);
+        bool isSharedMemory();
+
+    private:
+        Visual* findVisual(unsigned long visual);
+        bool reserveSegment(size_t size);
+        void releaseSegment();
+        void releaseImage();
+
+        Display* mDisplay;
+        bool mIsSharedMemory;
+
+        XShmSegmentInfo mSegment;
+        size_t mSegmentSize;     // 0 if none is attached.
+
+        XImage* mImage;
+        bool mIsImageShared;     // its data is the segment's.
+};
+
+/**
+ * Module Method stubs.
+ */
+bool writeCaptureImage(OutputWriter&, XImage*, bool isRgba);
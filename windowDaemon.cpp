@@ -0,0 +1,410 @@
+/**
+ * Resident daemon: keeps one X connection & WindowSnapshot,
+ * current from X events, and serves verbs over a Unix socket.
+ *
+ * A request is the verb's args, each '\0' terminated, ended by
+ * the client shutting down its write side. The reply is the
+ * verb's output, ended by the daemon closing the connection.
+ */
+
+// Std C and c++.
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+// X11.
+#include <X11/Xlib.h>
+
+// Application.
+#include "dox11cmd.h"
+#include "windowDaemon.h"
+#include "windowSnapshot.h"
+#include "xDisplayHelper.h"
+
+
+/**
+ * Module globals.
+ */
+static volatile sig_atomic_t mIsStopRequested = 0;
+
+
+/**
+ * Module helpers.
+ */
+static void handleStopSignal(int) {
+    mIsStopRequested = 1;
+}
+
+static bool
+getSocketAddress(const string& path, sockaddr_un* address) {
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address->sun_path)) {
+        return false;
+    }
+    strcpy(address->sun_path, path.c_str());
+    return true;
+}
+
+static int connectSocket(const string& path) {
+    sockaddr_un address;
+    if (!getSocketAddress(path, &address)) {
+        return -1;
+    }
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, (sockaddr*) &address, sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * Helper checks the process at the other end is this user's.
+ */
+static bool isPeerOwnUser(int fd) {
+    ucred credentials;
+    socklen_t length = sizeof(credentials);
+    return getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials,
+        &length) == 0 && credentials.uid == getuid();
+}
+
+/**
+ * Helper checks a socket path is this user's alone: the socket
+ * is ours with no group or other access, in a directory no one
+ * else can replace it in (ours or root's, and sticky if shared).
+ */
+static bool isSocketPathOwnUser(const string& path) {
+    struct stat socketStat;
+    if (lstat(path.c_str(), &socketStat) != 0 ||
+            !S_ISSOCK(socketStat.st_mode) ||
+            socketStat.st_uid != getuid() ||
+            (socketStat.st_mode & 077)) {
+        return false;
+    }
+
+    const size_t slash = path.rfind('/');
+    const string directory = slash == string::npos ? "." :
+        slash == 0 ? "/" : path.substr(0, slash);
+    struct stat directoryStat;
+    if (lstat(directory.c_str(), &directoryStat) != 0 ||
+            !S_ISDIR(directoryStat.st_mode)) {
+        return false;
+    }
+    if (directoryStat.st_uid != getuid() && directoryStat.st_uid != 0) {
+        return false;
+    }
+    return !(directoryStat.st_mode & (S_IWGRP | S_IWOTH)) ||
+        (directoryStat.st_mode & S_ISVTX);
+}
+
+static bool writeAll(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        const ssize_t written = write(fd, data, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        length -= written;
+    }
+    return true;
+}
+
+
+/**
+ * Socket path, one per user & X display. The screen number is
+ * dropped so ":0" and ":0.0" share a daemon.
+ */
+string getDaemonSocketPath(const char* displayName) {
+    string display = displayName ? displayName : "";
+
+    const size_t colon = display.rfind(':');
+    if (colon != string::npos) {
+        const size_t dot = display.find('.', colon);
+        if (dot != string::npos) {
+            display.erase(dot);
+        }
+    }
+    for (size_t i = 0; i < display.size(); i++) {
+        if (display[i] == '/') {
+            display[i] = '_';
+        }
+    }
+
+    const char* runtimeDir = getenv("XDG_RUNTIME_DIR");
+    if (runtimeDir && runtimeDir[0]) {
+        return string(runtimeDir) + "/dox11cmd-" + display + ".sock";
+    }
+    return "/tmp/dox11cmd-" + to_string(getuid()) + "-" +
+        display + ".sock";
+}
+
+/**
+ * Client side: have a running daemon serve the verb. Only this
+ * user's daemon, on a socket no one else could have put there.
+ */
+bool doDaemonRequest(const vector<string>& args, OutputWriter& out) {
+    const char* displayName = getenv("DISPLAY");
+    if (!displayName || !displayName[0]) {
+        return false;
+    }
+
+    const string socketPath = getDaemonSocketPath(displayName);
+    if (!isSocketPathOwnUser(socketPath)) {
+        return false;
+    }
+    const int fd = connectSocket(socketPath);
+    if (fd < 0) {
+        return false;
+    }
+    if (!isPeerOwnUser(fd)) {
+        close(fd);
+        return false;
+    }
+
+    string request;
+    for (size_t i = 0; i < args.size(); i++) {
+        request += args[i];
+        request += '\0';
+    }
+    if (!writeAll(fd, request.data(), request.size())) {
+        close(fd);
+        return false;
+    }
+    shutdown(fd, SHUT_WR);
+
+    char buffer[4096];
+    ssize_t length;
+    while ((length = read(fd, buffer, sizeof(buffer))) != 0) {
+        if (length < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        out.write(buffer, length);
+    }
+
+    close(fd);
+    return true;
+}
+
+
+/**
+ * Class instantiation.
+ */
+WindowDaemon::WindowDaemon(xDisplayHelper* displayHelper,
+        WindowSnapshot* snapshot) {
+    mDisplayHelper = displayHelper;
+    mSnapshot = snapshot;
+
+    mSocketPath = getDaemonSocketPath(
+        DisplayString(displayHelper->getDisplay()));
+    mListenSocket = -1;
+}
+
+WindowDaemon::~WindowDaemon() {
+    if (mListenSocket >= 0) {
+        close(mListenSocket);
+        unlink(mSocketPath.c_str());
+    }
+}
+
+/**
+ * Serve until SIGINT / SIGTERM.
+ */
+bool WindowDaemon::run() {
+    if (!openSocket()) {
+        return false;
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handleStopSignal;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    // Select, then re-read: nothing changed since the first
+    // collect() is served stale.
+    mSnapshot->selectEvents();
+    mSnapshot->markStale();
+    mSnapshot->update();
+
+    OutputWriter out(STDOUT_FILENO);
+    out << COLOR_BLUE << "\ndox11cmd: Daemon serving on " <<
+        mSocketPath << COLOR_NORMAL << "\n";
+    out.flush();
+
+    Display* display = mDisplayHelper->getDisplay();
+    while (!mIsStopRequested) {
+        handleXEvents();
+
+        pollfd fds[2];
+        fds[0].fd = ConnectionNumber(display);
+        fds[0].events = POLLIN;
+        fds[1].fd = mListenSocket;
+        fds[1].events = POLLIN;
+
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        if (fds[1].revents & POLLIN) {
+            const int clientSocket = accept4(mListenSocket,
+                NULL, NULL, SOCK_CLOEXEC);
+            if (clientSocket >= 0) {
+                handleClient(clientSocket);
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Create the listening socket, replacing a stale one.
+ */
+bool WindowDaemon::openSocket() {
+    OutputWriter out(STDOUT_FILENO);
+
+    sockaddr_un address;
+    if (!getSocketAddress(mSocketPath, &address)) {
+        out << COLOR_RED << "\ndox11cmd: Daemon socket path is "
+            "too long." << COLOR_NORMAL << "\n";
+        return false;
+    }
+
+    const int runningSocket = connectSocket(mSocketPath);
+    if (runningSocket >= 0) {
+        close(runningSocket);
+        out << COLOR_RED << "\ndox11cmd: A daemon is already "
+            "serving this display." << COLOR_NORMAL << "\n";
+        return false;
+    }
+    unlink(mSocketPath.c_str());
+
+    mListenSocket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (mListenSocket < 0) {
+        return false;
+    }
+
+    const mode_t oldMask = umask(0077);
+    const bool isBound = bind(mListenSocket, (sockaddr*) &address,
+        sizeof(address)) == 0;
+    umask(oldMask);
+
+    if (!isBound || listen(mListenSocket, 16) != 0) {
+        out << COLOR_RED << "\ndox11cmd: Cannot open daemon socket " <<
+            mSocketPath << ": " << strerror(errno) << COLOR_NORMAL << "\n";
+        close(mListenSocket);
+        mListenSocket = -1;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Drain queued X events into the snapshot. They only mark what
+ * is stale; the re-read happens once, when a client asks.
+ */
+void WindowDaemon::handleXEvents() {
+    Display* display = mDisplayHelper->getDisplay();
+
+    while (XPending(display)) {
+        XEvent event;
+        XNextEvent(display, &event);
+        mSnapshot->handleEvent(event);
+    }
+}
+
+/**
+ * Serve one client request, from this user only.
+ */
+void WindowDaemon::handleClient(int clientSocket) {
+    if (!isPeerOwnUser(clientSocket)) {
+        close(clientSocket);
+        return;
+    }
+
+    // Don't let a stuck client hold the daemon: not sending its
+    // request, nor reading its reply.
+    timeval timeout = { 1, 0 };
+    setsockopt(clientSocket, SOL_SOCKET, SO_RCVTIMEO,
+        &timeout, sizeof(timeout));
+    timeval sendTimeout = { 5, 0 };
+    setsockopt(clientSocket, SOL_SOCKET, SO_SNDTIMEO,
+        &sendTimeout, sizeof(sendTimeout));
+
+    string request;
+    char buffer[4096];
+    ssize_t length;
+    while ((length = read(clientSocket, buffer, sizeof(buffer))) != 0) {
+        if (length < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            close(clientSocket);
+            return;
+        }
+        request.append(buffer, length);
+        if (request.size() > MAX_DAEMON_REQUEST_LENGTH) {
+            close(clientSocket);
+            return;
+        }
+    }
+
+    vector<string> args;
+    size_t start = 0;
+    for (size_t i = 0; i < request.size(); i++) {
+        if (request[i] == '\0') {
+            args.push_back(request.substr(start, i - start));
+            start = i + 1;
+        }
+    }
+
+    // Bring the snapshot current, then run the verb. watch
+    // never returns, and wait blocks on its own events, so both
+    // are only run locally.
+    handleXEvents();
+    mSnapshot->update();
+
+    // The reply goes straight to the client, through the writer.
+    {
+        OutputWriter out(clientSocket);
+        vector<string> verbArgs = args;
+        if (out.applyOptions(verbArgs)) {
+            if (!verbArgs.empty() && (verbArgs[0] == "watch" ||
+                    verbArgs[0] == "wait")) {
+                out << COLOR_RED << "\ndox11cmd: watch & wait are not "
+                    "served by the daemon." << COLOR_NORMAL << "\n";
+            } else {
+                doCommand(verbArgs, out);
+            }
+        }
+        syncRequests(out);
+    }
+    close(clientSocket);
+}
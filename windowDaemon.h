@@ -0,0 +1,47 @@
+#pragma once
+
+/**
+ * Resident daemon: keeps one X connection & WindowSnapshot,
+ * current from X events, and serves verbs over a Unix socket.
+ */
+
+// Std C and c++.
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Application.
+#include "outputWriter.h"
+#include "windowSnapshot.h"
+#include "xDisplayHelper.h"
+
+#define MAX_DAEMON_REQUEST_LENGTH 65536
+
+/**
+ * Client side. Returns false when no daemon is reachable.
+ */
+bool doDaemonRequest(const vector<string>& args, OutputWriter&);
+string getDaemonSocketPath(const char* displayName);
+
+/**
+ * Class def.
+ */
+class WindowDaemon {
+    public:
+        WindowDaemon(xDisplayHelper*, WindowSnapshot*);
+        ~WindowDaemon();
+
+        bool run();
+
+    private:
+        bool openSocket();
+        void handleXEvents();
+        void handleClient(int clientSocket);
+
+        xDisplayHelper* mDisplayHelper;
+        WindowSnapshot* mSnapshot;
+
+        string mSocketPath;
+        int mListenSocket;
+};
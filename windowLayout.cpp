@@ -0,0 +1,119 @@
+/**
+ * Window layout: cells for the tile verb.
+ */
+
+// Std C and c++.
+#include <cmath>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// X11.
+#include <X11/Xlib.h>
+
+// Application.
+#include "dox11Types.h"
+#include "windowLayout.h"
+
+
+/**
+ * Module helpers.
+ */
+
+// Cell "index" of "count" across a span: edges are rounded from
+// the span's start, so the cells tile it with no gaps.
+static void splitSpan(int start, unsigned int length, size_t index,
+        size_t count, int* cellStart, unsigned int* cellLength) {
+    const long first = start + (long) length * index / count;
+    const long last = start + (long) length * (index + 1) / count;
+    *cellStart = first;
+    *cellLength = last - first;
+}
+
+static LayoutRect getCell(const LayoutRect& area, size_t column,
+        size_t columns, size_t row, size_t rows) {
+    LayoutRect cell;
+    splitSpan(area.x, area.w, column, columns, &cell.x, &cell.w);
+    splitSpan(area.y, area.h, row, rows, &cell.y, &cell.h);
+    return cell;
+}
+
+
+/**
+ * Layout by name: grid, columns or master.
+ */
+bool getLayout(const string& name, LAYOUT* layout) {
+    if (name == "grid") {
+        *layout = LAYOUT_GRID;
+    } else if (name == "columns") {
+        *layout = LAYOUT_COLUMNS;
+    } else if (name == "master") {
+        *layout = LAYOUT_MASTER;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * One cell per Window, in the order given.
+ */
+vector<LayoutRect> computeLayout(LAYOUT layout, const LayoutRect& area,
+        size_t count) {
+    vector<LayoutRect> cells;
+    if (count == 0) {
+        return cells;
+    }
+    cells.reserve(count);
+
+    switch (layout) {
+        case LAYOUT_COLUMNS:
+            for (size_t i = 0; i < count; i++) {
+                cells.push_back(getCell(area, i, count, 0, 1));
+            }
+            break;
+
+        case LAYOUT_MASTER:
+            if (count == 1) {
+                cells.push_back(area);
+                break;
+            }
+            cells.push_back(getCell(area, 0, 2, 0, 1));
+            for (size_t i = 1; i < count; i++) {
+                cells.push_back(getCell(area, 1, 2, i - 1, count - 1));
+            }
+            break;
+
+        default: {
+            const size_t columns = ceil(sqrt((double) count));
+            const size_t rows = (count + columns - 1) / columns;
+            for (size_t i = 0; i < count; i++) {
+                const size_t row = i / columns;
+                const size_t rowColumns = row == rows - 1 ?
+                    count - row * columns : columns;
+                cells.push_back(getCell(area, i % columns, rowColumns,
+                    row, rows));
+            }
+        }
+    }
+
+    return cells;
+}
+
+/**
+ * The client area that puts a Window's frame on a cell; at least
+ * 1 x 1.
+ */
+LayoutRect getClientRect(const LayoutRect& cell,
+        const FrameExtents& frame) {
+    LayoutRect client;
+    client.x = cell.x + frame.left;
+    client.y = cell.y + frame.top;
+
+    const long width = (long) cell.w - frame.left - frame.right;
+    const long height = (long) cell.h - frame.top - frame.bottom;
+    client.w = width > 0 ? width : 1;
+    client.h = height > 0 ? height : 1;
+    return client;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+/**
+ * Window layout: the cells a tile verb places Windows in, first
+ * (top-most) Window first, within a work area. Computed with no
+ * X requests; the caller fits each Window's frame to its cell.
+ *
+ *    grid      rows of equal cells, near square; the last row's
+ *              cells widen to fill it
+ *    columns   one column each, side by side
+ *    master    the first Window on the left half, the rest
+ *              stacked on the right
+ */
+
+// Std C and c++.
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// X11.
+#include <X11/Xlib.h>
+
+// Application.
+#include "dox11Types.h"
+
+/**
+ * Module Types, Enums, & Defines.
+ */
+enum LAYOUT {
+    LAYOUT_GRID,
+    LAYOUT_COLUMNS,
+    LAYOUT_MASTER
+};
+
+/**
+ * Module Method stubs.
+ */
+bool getLayout(const string& name, LAYOUT*);
+vector<LayoutRect> computeLayout(LAYOUT, const LayoutRect& area,
+    size_t count);
+LayoutRect getClientRect(const LayoutRect& cell, const FrameExtents&);
@@ -0,0 +1,299 @@
+/**
+ * Window matcher: a WINDOW pattern, compiled once, then run
+ * against a WindowSnapshot.
+ *
+ * Substring modes search the snapshot's contiguous title arena
+ * in one pass, rather than each title in turn.
+ */
+
+// Std C and c++.
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fnmatch.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+// X11.
+#include <X11/Xlib.h>
+
+// Application.
+#include "windowMatcher.h"
+#include "windowSnapshot.h"
+
+
+/**
+ * Module helpers.
+ */
+static bool hasPrefix(string_view text, const char* prefix) {
+    return text.compare(0, strlen(prefix), prefix) == 0;
+}
+
+static void foldCase(string& text) {
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] >= 'A' && text[i] <= 'Z') {
+            text[i] += 'a' - 'A';
+        }
+    }
+}
+
+/**
+ * Substring search. With SSE2, 16 candidate positions are tested
+ * at once on the needle's first & last bytes, and only those
+ * passing both are compared in full.
+ */
+const char* findSubstring(const char* haystack, size_t haystackLength,
+        const char* needle, size_t needleLength) {
+    if (needleLength == 0 || needleLength > haystackLength) {
+        return NULL;
+    }
+
+    size_t i = 0;
+#ifdef __SSE2__
+    if (needleLength >= 2) {
+        const __m128i first = _mm_set1_epi8(needle[0]);
+        const __m128i last = _mm_set1_epi8(needle[needleLength - 1]);
+
+        for (; i + needleLength + 15 <= haystackLength; i += 16) {
+            const __m128i blockFirst = _mm_loadu_si128(
+                (const __m128i*) (haystack + i));
+            const __m128i blockLast = _mm_loadu_si128(
+                (const __m128i*) (haystack + i + needleLength - 1));
+
+            unsigned int mask = _mm_movemask_epi8(_mm_and_si128(
+                _mm_cmpeq_epi8(first, blockFirst),
+                _mm_cmpeq_epi8(last, blockLast)));
+            while (mask) {
+                const int bit = __builtin_ctz(mask);
+                if (memcmp(haystack + i + bit + 1, needle + 1,
+                        needleLength - 2) == 0) {
+                    return haystack + i + bit;
+                }
+                mask &= mask - 1;
+            }
+        }
+    }
+#endif
+
+    return (const char*) memmem(haystack + i, haystackLength - i,
+        needle, needleLength);
+}
+
+
+/**
+ * Class instantiation: compile the pattern.
+ */
+WindowMatcher::WindowMatcher(const string& pattern) {
+    mMode = MATCH_BEST;
+    mPattern = pattern;
+    mIsValid = true;
+    mNumber = 0;
+    mWorkspace = 0;
+
+    if (hasPrefix(pattern, "re:")) {
+        mMode = MATCH_REGEX;
+        mPattern = pattern.substr(3);
+        try {
+            mRegex = regex(mPattern, regex::ECMAScript | regex::optimize);
+        } catch (const regex_error& error) {
+            mIsValid = false;
+            mError = error.what();
+        }
+    } else if (hasPrefix(pattern, "glob:")) {
+        mMode = MATCH_GLOB;
+        mPattern = pattern.substr(5);
+    } else if (hasPrefix(pattern, "sub:")) {
+        mMode = MATCH_SUBSTRING;
+        mPattern = pattern.substr(4);
+    } else if (hasPrefix(pattern, "i:")) {
+        mMode = MATCH_FOLDED;
+        mPattern = pattern.substr(2);
+        foldCase(mPattern);
+    } else if (hasPrefix(pattern, "class:")) {
+        mMode = MATCH_CLASS;
+        mPattern = pattern.substr(6);
+    } else if (hasPrefix(pattern, "pid:") || hasPrefix(pattern, "id:")) {
+        mMode = pattern[0] == 'p' ? MATCH_PID : MATCH_ID;
+        mPattern = pattern.substr(pattern.find(':') + 1);
+
+        char* end = NULL;
+        mNumber = strtoul(mPattern.c_str(), &end, 0);
+        if (mPattern.empty() || *end) {
+            mIsValid = false;
+            mError = "not a number";
+        }
+    } else if (hasPrefix(pattern, "ws:")) {
+        mMode = MATCH_WORKSPACE;
+        mPattern = pattern.substr(3);
+
+        char* end = NULL;
+        mWorkspace = strtol(mPattern.c_str(), &end, 10);
+        if (mPattern.empty() || *end) {
+            mIsValid = false;
+            mError = "not a number";
+        }
+    } else if (hasPrefix(pattern, "=")) {
+        mMode = MATCH_EXACT;
+        mPattern = pattern.substr(1);
+    } else if (hasPrefix(pattern, "^")) {
+        mMode = MATCH_PREFIX;
+        mPattern = pattern.substr(1);
+    }
+}
+
+bool WindowMatcher::isValid() {
+    return mIsValid;
+}
+
+const string& WindowMatcher::getError() {
+    return mError;
+}
+
+/**
+ * All matching Windows, as snapshot indexes, top-most first.
+ */
+vector<size_t> WindowMatcher::match(WindowSnapshot& snapshot) {
+    if (!mIsValid) {
+        return vector<size_t>();
+    }
+    return match(snapshot, mMode);
+}
+
+/**
+ * Helper matches in one mode; the pattern's own, or each of
+ * BEST's in turn.
+ */
+vector<size_t> WindowMatcher::match(WindowSnapshot& snapshot,
+        MATCH_MODE mode) {
+    vector<size_t> result;
+
+    // Exact match includes empty name. Else grab partial.
+    if (mode == MATCH_BEST) {
+        result = match(snapshot, MATCH_EXACT);
+        if (result.empty()) {
+            matchSubstring(snapshot, MATCH_SUBSTRING, result);
+        }
+        return result;
+    }
+
+    if (mode == MATCH_SUBSTRING || mode == MATCH_FOLDED) {
+        matchSubstring(snapshot, mode, result);
+        return result;
+    }
+
+    if (mode == MATCH_WORKSPACE) {
+        const vector<size_t>& windows = snapshot.getWorkspaceWindows(
+            mWorkspace);
+        result.assign(windows.rbegin(), windows.rend());
+        return result;
+    }
+
+    for (int i = snapshot.size() - 1; i >= 0; i--) {
+        bool isMatch = false;
+
+        switch (mode) {
+            case MATCH_CLASS: {
+                const string& wmClass = snapshot.getClass(i);
+                const size_t split = wmClass.find('\0');
+                isMatch = wmClass.compare(0, split, mPattern) == 0 ||
+                    (split != string::npos &&
+                        strcmp(wmClass.c_str() + split + 1,
+                            mPattern.c_str()) == 0);
+                break;
+            }
+
+            case MATCH_PID:
+                isMatch = (unsigned long) snapshot.getInfo(i)->pid ==
+                    mNumber;
+                break;
+
+            case MATCH_ID:
+                isMatch = snapshot.getInfo(i)->id == mNumber;
+                break;
+
+            default:
+                isMatch = isTitleMatch(snapshot.getTitle(i), mode);
+        }
+
+        if (isMatch) {
+            result.push_back(i);
+        }
+    }
+
+    return result;
+}
+
+/**
+ * Top-most matching Window, or None.
+ */
+Window WindowMatcher::matchFirst(WindowSnapshot& snapshot) {
+    vector<size_t> matches = match(snapshot);
+    return matches.empty() ? None :
+        snapshot.getInfo(matches[0])->id;
+}
+
+bool WindowMatcher::isTitleMatch(string_view title, MATCH_MODE mode) {
+    switch (mode) {
+        case MATCH_EXACT:
+            return title == mPattern;
+
+        case MATCH_PREFIX:
+            return hasPrefix(title, mPattern.c_str());
+
+        // Arena titles are '\0' terminated.
+        case MATCH_GLOB:
+            return fnmatch(mPattern.c_str(), title.data(), 0) == 0;
+
+        case MATCH_REGEX:
+            return regex_search(title.begin(), title.end(), mRegex);
+
+        default:
+            return false;
+    }
+}
+
+/**
+ * Substring match over the snapshot's title arena. A hit can't
+ * straddle two titles, the needle has no '\0' separator in it.
+ */
+void WindowMatcher::matchSubstring(WindowSnapshot& snapshot,
+        MATCH_MODE mode, vector<size_t>& result) {
+    if (mPattern.empty()) {
+        return;
+    }
+
+    string foldedBuffer;
+    const string* buffer = &snapshot.getTitleArena();
+    if (mode == MATCH_FOLDED) {
+        foldedBuffer = *buffer;
+        foldCase(foldedBuffer);
+        buffer = &foldedBuffer;
+    }
+
+    const char* start = buffer->data();
+    const size_t length = buffer->size();
+    size_t position = 0;
+    while (position < length) {
+        const char* hit = findSubstring(start + position,
+            length - position, mPattern.data(), mPattern.size());
+        if (!hit) {
+            break;
+        }
+
+        // One entry per Window; resume at the next title.
+        const size_t index = snapshot.findTitleIndex(hit - start);
+        result.push_back(index);
+        position = index + 1 < snapshot.size() ?
+            snapshot.getInfo(index + 1)->titleOffset : length;
+    }
+
+    reverse(result.begin(), result.end());
+}
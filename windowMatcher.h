@@ -0,0 +1,83 @@
+#pragma once
+
+/**
+ * Window matcher: a WINDOW pattern, compiled once, then run
+ * against a WindowSnapshot.
+ *
+ *    NAME          exact title, else title substring (default)
+ *    =NAME         exact title
+ *    ^NAME         title prefix
+ *    sub:NAME      title substring, never exact first
+ *    i:NAME        title substring, ASCII case folded
+ *    glob:PATTERN  whole title, shell glob
+ *    re:PATTERN    title, ECMAScript regex search
+ *    class:NAME    WM_CLASS instance or class
+ *    pid:N         _NET_WM_PID
+ *    id:N          Window id (0x.. hex or decimal)
+ *    ws:N          on workspace N (-1: on all), from the
+ *                  snapshot's workspace index
+ */
+
+// Std C and c++.
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+// X11.
+#include <X11/Xlib.h>
+
+// Application.
+#include "windowSnapshot.h"
+
+/**
+ * Module Types, Enums, & Defines.
+ */
+enum MATCH_MODE {
+    MATCH_BEST,
+    MATCH_EXACT,
+    MATCH_PREFIX,
+    MATCH_SUBSTRING,
+    MATCH_FOLDED,
+    MATCH_GLOB,
+    MATCH_REGEX,
+    MATCH_CLASS,
+    MATCH_PID,
+    MATCH_ID,
+    MATCH_WORKSPACE
+};
+
+/**
+ * Class def.
+ */
+class WindowMatcher {
+    public:
+        WindowMatcher(const string& pattern);
+
+        bool isValid();
+        const string& getError();
+
+        // Snapshot indexes, top-most first.
+        vector<size_t> match(WindowSnapshot&);
+        Window matchFirst(WindowSnapshot&);
+
+    private:
+        vector<size_t> match(WindowSnapshot&, MATCH_MODE);
+        bool isTitleMatch(string_view title, MATCH_MODE);
+        void matchSubstring(WindowSnapshot&, MATCH_MODE,
+            vector<size_t>&);
+
+        MATCH_MODE mMode;
+        string mPattern;
+        bool mIsValid;
+        string mError;
+
+        regex mRegex;
+        unsigned long mNumber;
+        long mWorkspace;
+};
+
+const char* findSubstring(const char* haystack, size_t haystackLength,
+    const char* needle, size_t needleLength);
@@ -0,0 +1,210 @@
+/**
+ * Window region index: which Window owns each part of the screen,
+ * from a WindowSnapshot's stacked rectangles.
+ *
+ * The screen is cut at every on-screen Window edge into a grid
+ * of cells, at most (2n + 1) x (2n + 1), fewer once clipped to the
+ * screen. A sweep down the strips keeps the Windows crossing the
+ * current strip, top-most first; each paints only the cells in
+ * its span that nothing above has, skipping painted runs through
+ * a "next unpainted" union-find. Each cell is painted once, so a
+ * strip costs O(cells + Windows), and visible areas fall out of
+ * the painting.
+ */
+
+// Std C and c++.
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+using namespace std;
+
+// X11.
+#include <X11/Xlib.h>
+
+// Application.
+#include "dox11Types.h"
+#include "windowRegion.h"
+#include "windowSnapshot.h"
+
+
+/**
+ * Module Types, Enums, & Defines.
+ */
+typedef struct {
+        int x0, y0, x1, y1;    // clipped, then as slab & strip.
+        int index;             // snapshot index.
+} WinRect;
+
+
+/**
+ * Module helpers.
+ */
+static int clampTo(long value, int high) {
+    return value < 0 ? 0 : value > high ? high : (int) value;
+}
+
+static int findSlab(const vector<int>& edges, int value) {
+    return lower_bound(edges.begin(), edges.end(), value) -
+        edges.begin();
+}
+
+// First unpainted slab at or after "slab", path halving.
+static int findUnpainted(vector<int>& next, int slab) {
+    while (next[slab] != slab) {
+        next[slab] = next[next[slab]];
+        slab = next[slab];
+    }
+    return slab;
+}
+
+/**
+ * Whether a Window can be seen at all: not hidden, and on the
+ * current workspace (or all of them).
+ */
+bool isWindowOnScreen(const WinInfo& winInfoItem, long currentDesktop) {
+    return !winInfoItem.hidden && (winInfoItem.sticky ||
+        winInfoItem.ws < 0 || currentDesktop < 0 ||
+        winInfoItem.ws == currentDesktop);
+}
+
+
+/**
+ * Class instantiation.
+ */
+WindowRegionIndex::WindowRegionIndex() {
+    mSnapshot = NULL;
+    mGeneration = 0;
+}
+
+void WindowRegionIndex::build(WindowSnapshot& snapshot) {
+    mSnapshot = &snapshot;
+    mGeneration = snapshot.getGeneration();
+
+    const int width = snapshot.getRootWidth();
+    const int height = snapshot.getRootHeight();
+    const long currentDesktop = snapshot.getCurrentDesktop();
+
+    mVisibleAreas.assign(snapshot.size(), 0);
+    mXs.assign({ 0, width });
+    mYs.assign({ 0, height });
+
+    // On-screen rectangles, clipped to the screen.
+    vector<WinRect> rects;
+    for (size_t i = 0; i < snapshot.size(); i++) {
+        const WinInfo* winInfoItem = snapshot.getInfo(i);
+        if (!isWindowOnScreen(*winInfoItem, currentDesktop)) {
+            continue;
+        }
+
+        WinRect rect;
+        rect.x0 = clampTo(winInfoItem->xa, width);
+        rect.y0 = clampTo(winInfoItem->ya, height);
+        rect.x1 = clampTo((long) winInfoItem->xa + winInfoItem->w, width);
+        rect.y1 = clampTo((long) winInfoItem->ya + winInfoItem->h,
+            height);
+        rect.index = i;
+        if (rect.x0 >= rect.x1 || rect.y0 >= rect.y1) {
+            continue;
+        }
+
+        rects.push_back(rect);
+        mXs.push_back(rect.x0);
+        mXs.push_back(rect.x1);
+        mYs.push_back(rect.y0);
+        mYs.push_back(rect.y1);
+    }
+
+    sort(mXs.begin(), mXs.end());
+    mXs.erase(unique(mXs.begin(), mXs.end()), mXs.end());
+    sort(mYs.begin(), mYs.end());
+    mYs.erase(unique(mYs.begin(), mYs.end()), mYs.end());
+
+    const int slabs = mXs.size() - 1;
+    const int strips = mYs.size() - 1;
+    mOwners.assign((size_t) slabs * strips, -1);
+
+    // To cells. Snapshot order is bottom-most first, so by start
+    // strip, then top-most first.
+    for (size_t i = 0; i < rects.size(); i++) {
+        rects[i].x0 = findSlab(mXs, rects[i].x0);
+        rects[i].x1 = findSlab(mXs, rects[i].x1);
+        rects[i].y0 = findSlab(mYs, rects[i].y0);
+        rects[i].y1 = findSlab(mYs, rects[i].y1);
+    }
+    stable_sort(rects.begin(), rects.end(),
+        [](const WinRect& a, const WinRect& b) {
+            return a.y0 < b.y0;
+        });
+
+    // Sweep down, painting each strip top-most Window first.
+    vector<const WinRect*> active;
+    vector<int> next(slabs + 1);
+    size_t nextRect = 0;
+    for (int strip = 0; strip < strips; strip++) {
+        active.erase(remove_if(active.begin(), active.end(),
+            [strip](const WinRect* rect) {
+                return rect->y1 <= strip;
+            }), active.end());
+
+        for (; nextRect < rects.size() && rects[nextRect].y0 == strip;
+                nextRect++) {
+            const WinRect* rect = &rects[nextRect];
+            active.insert(upper_bound(active.begin(), active.end(), rect,
+                [](const WinRect* a, const WinRect* b) {
+                    return a->index > b->index;
+                }), rect);
+        }
+
+        iota(next.begin(), next.end(), 0);
+        int32_t* owners = &mOwners[(size_t) strip * slabs];
+        const unsigned long stripHeight = mYs[strip + 1] - mYs[strip];
+
+        for (size_t i = 0; i < active.size(); i++) {
+            const WinRect* rect = active[i];
+            for (int slab = findUnpainted(next, rect->x0);
+                    slab < rect->x1; slab = findUnpainted(next, slab)) {
+                owners[slab] = rect->index;
+                mVisibleAreas[rect->index] += stripHeight *
+                    (mXs[slab + 1] - mXs[slab]);
+                next[slab] = slab + 1;
+            }
+        }
+    }
+}
+
+/**
+ * Whether the index is current for a snapshot.
+ */
+bool WindowRegionIndex::isBuiltFor(WindowSnapshot* snapshot) {
+    return mSnapshot == snapshot &&
+        mGeneration == snapshot->getGeneration();
+}
+
+unsigned long WindowRegionIndex::getVisibleArea(size_t index) {
+    return mVisibleAreas[index];
+}
+
+/**
+ * Visible share of the whole Window, off-screen parts included.
+ */
+int WindowRegionIndex::getVisiblePercent(size_t index) {
+    const WinInfo* winInfoItem = mSnapshot->getInfo(index);
+    const unsigned long area = (unsigned long) winInfoItem->w *
+        winInfoItem->h;
+    return area ? mVisibleAreas[index] * 100 / area : 0;
+}
+
+int WindowRegionIndex::findWindowAt(int x, int y) {
+    if (x < mXs.front() || x >= mXs.back() || y < mYs.front() ||
+            y >= mYs.back()) {
+        return -1;
+    }
+
+    const int slab = upper_bound(mXs.begin(), mXs.end(), x) -
+        mXs.begin() - 1;
+    const int strip = upper_bound(mYs.begin(), mYs.end(), y) -
+        mYs.begin() - 1;
+    return mOwners[(size_t) strip * (mXs.size() - 1) + slab];
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+/**
+ * Window region index: which Window owns each part of the screen,
+ * from a WindowSnapshot's stacked rectangles. Gives each Window's
+ * visible (unoccluded) area, and the top-most Window at a point,
+ * without asking the X server.
+ */
+
+// Std C and c++.
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+// Application.
+#include "dox11Types.h"
+#include "windowSnapshot.h"
+
+/**
+ * Class def.
+ */
+class WindowRegionIndex {
+    public:
+        WindowRegionIndex();
+
+        void build(WindowSnapshot&);
+        bool isBuiltFor(WindowSnapshot*);
+
+        // By snapshot index.
+        unsigned long getVisibleArea(size_t index);
+        int getVisiblePercent(size_t index);
+
+        // Snapshot index of the top-most Window at x,y, or -1.
+        int findWindowAt(int x, int y);
+
+    private:
+        WindowSnapshot* mSnapshot;
+        unsigned long mGeneration;
+
+        // The screen cut at every Window edge: cell (slab, strip)
+        // spans mXs[slab]..mXs[slab + 1], mYs[strip]..mYs[strip + 1].
+        vector<int> mXs;
+        vector<int> mYs;
+        vector<int32_t> mOwners;   // snapshot index, or -1.
+
+        vector<unsigned long> mVisibleAreas;
+};
+
+/**
+ * Module Method stubs.
+ */
+bool isWindowOnScreen(const WinInfo&, long currentDesktop);
@@ -0,0 +1,1106 @@
+/**
+ * Snapshot of the stacked x11 Windows and root state, collected
+ * once per invocation in one pipelined pass over an XCB
+ * connection, and shared by all verbs & matchers.
+ *
+ * Every request for every Window is sent before any reply is
+ * read, so a full collect() costs two round trips (root
+ * properties, Windows) regardless of the Window count, plus one
+ * per further chunk of a property longer than its first read.
+ *
+ * Event maintenance only marks what an event made stale; update()
+ * then re-reads just that, again pipelined.
+ */
+
+// Std C and c++.
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+// X11.
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <xcb/xcb.h>
+
+// Application.
+#include "dox11Types.h"
+#include "utf8Helper.h"
+#include "windowSnapshot.h"
+#include "xDisplayHelper.h"
+#include "xStats.h"
+#include "xTrace.h"
+
+
+/**
+ * Module Types, Enums, & Defines.
+ */
+
+// Outstanding requests for one Window.
+typedef struct {
+    xcb_get_window_attributes_cookie_t attributes;
+    xcb_get_geometry_cookie_t geometry;
+    xcb_translate_coordinates_cookie_t coordinates;
+    xcb_get_property_cookie_t name;
+    xcb_get_property_cookie_t netName;
+    xcb_get_property_cookie_t netDesktop;
+    xcb_get_property_cookie_t winWorkspace;
+    xcb_get_property_cookie_t netState;
+    xcb_get_property_cookie_t windowType;
+    xcb_get_property_cookie_t wmState;
+    xcb_get_property_cookie_t wmClass;
+    xcb_get_property_cookie_t netPid;
+} WinCookies;
+
+// Property read lengths, in 32-bit units. The first request
+// covers typical values, so nearly every property costs one
+// pipelined reply; anything longer is read on, chunk by chunk.
+#define PROPERTY_CHUNK_LONGS 4096
+#define TITLE_LONGS 256
+#define CLASS_LONGS 64
+#define ATOM_LIST_LONGS 32
+
+
+/**
+ * Module helpers.
+ */
+
+// Fetch a property reply, discarding any error (BadWindow
+// for Windows destroyed mid-collect is expected).
+static xcb_get_property_reply_t*
+getPropertyReply(xcb_connection_t* connection,
+        xcb_get_property_cookie_t cookie, Window window) {
+    xcb_generic_error_t* error = NULL;
+    xcb_get_property_reply_t* reply = (xcb_get_property_reply_t*)
+        traceWaitForReply(connection, cookie.sequence, &error,
+            "GetProperty", window);
+    free(error);
+    return reply;
+}
+
+static bool isAtomList(xcb_get_property_reply_t* reply) {
+    return reply && reply->type == XCB_ATOM_ATOM && reply->format == 32;
+}
+
+static bool hasAtom(const string& atoms, xcb_atom_t atom) {
+    for (size_t i = 0; i + 4 <= atoms.size(); i += 4) {
+        xcb_atom_t item;
+        memcpy(&item, atoms.data() + i, 4);
+        if (item == atom) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool
+getFirstLong(xcb_get_property_reply_t* reply, long* result) {
+    if (!reply || reply->format != 32 ||
+            xcb_get_property_value_length(reply) < 4) {
+        return false;
+    }
+
+    // Sign extend, so "all workspaces" 0xFFFFFFFF reads as -1.
+    *result = (long) *(int32_t*) xcb_get_property_value(reply);
+    return true;
+}
+
+// Workspace, _NET_WM_DESKTOP first, else _WIN_WORKSPACE, else 0.
+static long getWorkspace(xcb_get_property_reply_t* netDesktop,
+        xcb_get_property_reply_t* winWorkspace) {
+    long workspace = 0;
+    if (!netDesktop || netDesktop->type != XCB_ATOM_CARDINAL ||
+            !getFirstLong(netDesktop, &workspace)) {
+        getFirstLong(winWorkspace, &workspace);
+    }
+    return workspace;
+}
+
+// On a workspace, or on all of them (ws -1, or sticky); -1 asks
+// for just those.
+static bool isOnWorkspace(const WinInfo& winInfoItem, long workspace) {
+    return winInfoItem.ws == workspace || winInfoItem.ws < 0 ||
+        winInfoItem.sticky;
+}
+
+
+/**
+ * Class instantiation.
+ */
+WindowSnapshot::WindowSnapshot(xDisplayHelper* displayHelper) {
+    mDisplayHelper = displayHelper;
+    mConnection = displayHelper->getXcbConnection();
+    mRoot = displayHelper->getRoot();
+    mIsDesktopVisible = true;
+
+    mIsEventSelected = false;
+    mIsStackingDirty = false;
+    mIsShowingDirty = false;
+    mIsActiveDirty = false;
+    mIsCurrentDesktopDirty = false;
+    mActiveWindow = None;
+    mCurrentDesktop = -1;
+    mGeneration = 0;
+    mWorkspaceGeneration = 0;
+    mWindowGeneration = 0;
+    mTopLevelGeneration = 0;
+}
+
+size_t WindowSnapshot::size() {
+    return mWinInfos.size();
+}
+
+WinInfo* WindowSnapshot::getInfo(size_t index) {
+    return &mWinInfos[index];
+}
+
+string_view WindowSnapshot::getTitle(size_t index) {
+    const WinInfo* winInfoItem = &mWinInfos[index];
+    return string_view(mTitleArena.data() + winInfoItem->titleOffset,
+        winInfoItem->titleLength);
+}
+
+/**
+ * WM_CLASS as "instance\0class".
+ */
+const string& WindowSnapshot::getClass(size_t index) {
+    return mClasses[index];
+}
+
+const string& WindowSnapshot::getTitleArena() {
+    return mTitleArena;
+}
+
+/**
+ * Index of the Window whose title holds an arena offset.
+ */
+size_t WindowSnapshot::findTitleIndex(size_t offset) {
+    auto title = upper_bound(mWinInfos.begin(), mWinInfos.end(), offset,
+        [](size_t offset, const WinInfo& winInfoItem) {
+            return offset < winInfoItem.titleOffset;
+        });
+    return title - mWinInfos.begin() - 1;
+}
+
+/**
+ * Index of a Window in stacked order, or -1. Indexed once per
+ * generation, for the daemon's events & every matched id.
+ */
+int WindowSnapshot::findWindow(Window window) {
+    if (mWindowGeneration != mGeneration) {
+        mWindowIndexes.clear();
+        for (size_t i = 0; i < mStackedWindows.size(); i++) {
+            mWindowIndexes.emplace(mStackedWindows[i], i);
+        }
+        mWindowGeneration = mGeneration;
+    }
+
+    auto index = mWindowIndexes.find(window);
+    return index == mWindowIndexes.end() ? -1 : (int) index->second;
+}
+
+const vector<Window>& WindowSnapshot::getStackedWindows() {
+    return mStackedWindows;
+}
+
+bool WindowSnapshot::isDesktopVisible() {
+    return mIsDesktopVisible;
+}
+
+Window WindowSnapshot::getActiveWindow() {
+    return mActiveWindow;
+}
+
+long WindowSnapshot::getCurrentDesktop() {
+    return mCurrentDesktop;
+}
+
+/**
+ * Root (screen) size, from the connection setup; no round trip.
+ */
+int WindowSnapshot::getRootWidth() {
+    return mDisplayHelper->getScreenWidth();
+}
+
+int WindowSnapshot::getRootHeight() {
+    return mDisplayHelper->getScreenHeight();
+}
+
+unsigned long WindowSnapshot::getGeneration() {
+    return mGeneration;
+}
+
+void WindowSnapshot::getPixelFormat(size_t index, int* depth,
+        unsigned long* visual) {
+    *depth = mWinStates[index].depth;
+    *visual = mWinStates[index].visual;
+}
+
+/**
+ * Stacked indexes of the Windows on a workspace, bottom-most
+ * first. Windows on all workspaces (ws -1, or sticky) are on
+ * every one, as isWindowOnScreen() has it; -1 asks for just
+ * those. Indexed once per workspace & generation.
+ */
+const vector<size_t>& WindowSnapshot::getWorkspaceWindows(long workspace) {
+    if (mWorkspaceGeneration != mGeneration) {
+        mWorkspaceIndexes.clear();
+        mWorkspaceGeneration = mGeneration;
+    }
+
+    auto windows = mWorkspaceIndexes.find(workspace);
+    if (windows != mWorkspaceIndexes.end()) {
+        return windows->second;
+    }
+
+    vector<size_t>& indexes = mWorkspaceIndexes[workspace];
+    for (size_t i = 0; i < mWinInfos.size(); i++) {
+        if (isOnWorkspace(mWinInfos[i], workspace)) {
+            indexes.push_back(i);
+        }
+    }
+    return indexes;
+}
+
+/**
+ * The root's child holding a stacked Window: its frame under a
+ * reparenting window manager, else the Window itself. Read for
+ * every stacked Window at once, once per generation. A Window
+ * not in the snapshot, or gone, is returned as is.
+ */
+Window WindowSnapshot::getTopLevelWindow(Window window) {
+    const int index = findWindow(window);
+    if (index < 0) {
+        return window;
+    }
+
+    if (mTopLevelGeneration != mGeneration ||
+            mTopLevelWindows.size() != mStackedWindows.size()) {
+        collectTopLevelWindows();
+        mTopLevelGeneration = mGeneration;
+    }
+    return mTopLevelWindows[index];
+}
+
+/**
+ * Whether the window manager lists a hint in _NET_SUPPORTED.
+ */
+bool WindowSnapshot::isSupported(X_ATOM atom) {
+    return find(mSupported.begin(), mSupported.end(),
+        getAtom(atom)) != mSupported.end();
+}
+
+xcb_atom_t WindowSnapshot::getAtom(X_ATOM atom) {
+    return mDisplayHelper->getAtom(atom);
+}
+
+/**
+ * Collect the whole table: send all requests for all Windows,
+ * then gather all replies.
+ */
+bool WindowSnapshot::collect() {
+    if (!collectStart()) {
+        return false;
+    }
+
+    vector<size_t> indexes(mWinInfos.size());
+    for (size_t i = 0; i < indexes.size(); i++) {
+        indexes[i] = i;
+    }
+    collectWindows(indexes);
+
+    return true;
+}
+
+/**
+ * Collect only the Windows on one workspace: every Window's
+ * workspace & state first (three properties each, pipelined),
+ * then the rest for just those on it. One round trip more than
+ * collect(), but nothing else is fetched for Windows elsewhere;
+ * they are kept with their workspace only, untitled & hidden.
+ * Windows on all workspaces (-1, or sticky) are on this one too,
+ * as getWorkspaceWindows() has them.
+ */
+bool WindowSnapshot::collectWorkspace(long workspace) {
+    if (!collectStart()) {
+        return false;
+    }
+
+    // Send phase.
+    const size_t count = mWinInfos.size();
+    vector<xcb_get_property_cookie_t> netDesktops(count);
+    vector<xcb_get_property_cookie_t> winWorkspaces(count);
+    vector<xcb_get_property_cookie_t> netStates(count);
+    for (size_t i = 0; i < count; i++) {
+        netDesktops[i] = xcb_get_property(mConnection, 0,
+            mWinInfos[i].id, getAtom(NET_WM_DESKTOP),
+            XCB_GET_PROPERTY_TYPE_ANY, 0, 1);
+        winWorkspaces[i] = xcb_get_property(mConnection, 0,
+            mWinInfos[i].id, getAtom(WIN_WORKSPACE),
+            XCB_GET_PROPERTY_TYPE_ANY, 0, 1);
+        netStates[i] = xcb_get_property(mConnection, 0,
+            mWinInfos[i].id, getAtom(NET_WM_STATE), XCB_ATOM_ATOM, 0,
+            ATOM_LIST_LONGS);
+    }
+    xcb_flush(mConnection);
+
+    // Gather phase.
+    vector<size_t> indexes;
+    for (size_t i = 0; i < count; i++) {
+        WinInfo* winInfoItem = &mWinInfos[i];
+        xcb_get_property_reply_t* netDesktop = getPropertyReply(
+            mConnection, netDesktops[i], winInfoItem->id);
+        xcb_get_property_reply_t* winWorkspace = getPropertyReply(
+            mConnection, winWorkspaces[i], winInfoItem->id);
+        winInfoItem->ws = getWorkspace(netDesktop, winWorkspace);
+        free(netDesktop);
+        free(winWorkspace);
+
+        xcb_get_property_reply_t* netState = getPropertyReply(
+            mConnection, netStates[i], winInfoItem->id);
+        mPropertyBuffer.clear();
+        if (isAtomList(netState)) {
+            appendPropertyValue(netState, winInfoItem->id,
+                getAtom(NET_WM_STATE), mPropertyBuffer);
+        }
+        free(netState);
+        winInfoItem->sticky = winInfoItem->ws == -1 ||
+            hasAtom(mPropertyBuffer, getAtom(NET_WM_STATE_STICKY));
+
+        if (isOnWorkspace(*winInfoItem, workspace)) {
+            indexes.push_back(i);
+            continue;
+        }
+        winInfoItem->hidden = true;
+        mWinStates[i].mapState = -1;
+    }
+    collectWindows(indexes);
+
+    return true;
+}
+
+/**
+ * Frames are 0 where the window manager sets none. The work area
+ * is _NET_WORKAREA's entry for the current workspace, else the
+ * first, else the whole root.
+ */
+void WindowSnapshot::collectLayoutState(const vector<size_t>& indexes,
+        vector<FrameExtents>& frames, LayoutRect* workArea) {
+    // Send phase.
+    xcb_get_property_cookie_t workAreaCookie = xcb_get_property(
+        mConnection, 0, mRoot, getAtom(NET_WORKAREA), XCB_ATOM_CARDINAL,
+        0, PROPERTY_CHUNK_LONGS);
+    vector<xcb_get_property_cookie_t> frameCookies(indexes.size());
+    for (size_t n = 0; n < indexes.size(); n++) {
+        frameCookies[n] = xcb_get_property(mConnection, 0,
+            mWinInfos[indexes[n]].id, getAtom(NET_FRAME_EXTENTS),
+            XCB_ATOM_CARDINAL, 0, 4);
+    }
+    xcb_flush(mConnection);
+
+    // Gather phase.
+    workArea->x = 0;
+    workArea->y = 0;
+    workArea->w = getRootWidth();
+    workArea->h = getRootHeight();
+    xcb_get_property_reply_t* workAreas = getPropertyReply(mConnection,
+        workAreaCookie, None);
+    if (workAreas && workAreas->format == 32) {
+        mPropertyBuffer.clear();
+        appendPropertyValue(workAreas, mRoot, getAtom(NET_WORKAREA),
+            mPropertyBuffer);
+
+        const size_t count = mPropertyBuffer.size() / 16;
+        const size_t desktop = mCurrentDesktop >= 0 &&
+            (size_t) mCurrentDesktop < count ? mCurrentDesktop : 0;
+        if (count > 0) {
+            uint32_t values[4];
+            memcpy(values, mPropertyBuffer.data() + desktop * 16, 16);
+            workArea->x = values[0];
+            workArea->y = values[1];
+            workArea->w = values[2];
+            workArea->h = values[3];
+        }
+    }
+    free(workAreas);
+
+    frames.assign(indexes.size(), FrameExtents());
+    for (size_t n = 0; n < indexes.size(); n++) {
+        xcb_get_property_reply_t* frame = getPropertyReply(mConnection,
+            frameCookies[n], mWinInfos[indexes[n]].id);
+        if (frame && frame->format == 32 &&
+                xcb_get_property_value_length(frame) >= 16) {
+            const uint32_t* values = (const uint32_t*)
+                xcb_get_property_value(frame);
+            frames[n].left = values[0];
+            frames[n].right = values[1];
+            frames[n].top = values[2];
+            frames[n].bottom = values[3];
+        }
+        free(frame);
+    }
+}
+
+/**
+ * Helper starts a collect: the root state, then a blank WinInfo
+ * for each stacked Window.
+ */
+bool WindowSnapshot::collectStart() {
+    mGeneration++;
+    mStackedWindows.clear();
+    mIsDesktopVisible = true;
+    mWinInfos.clear();
+    mWinStates.clear();
+    mClasses.clear();
+    mTitleArena.clear();
+
+    if (!mConnection || !collectRootState()) {
+        return false;
+    }
+
+    const size_t count = mStackedWindows.size();
+    mWinInfos.assign(count, WinInfo());
+    mWinStates.assign(count, WinState());
+    mClasses.resize(count);
+
+    for (size_t i = 0; i < count; i++) {
+        mWinInfos[i].id = mStackedWindows[i];
+    }
+    return true;
+}
+
+/**
+ * Collect the requested Windows: send all requests for all of
+ * them, then gather all replies.
+ */
+void WindowSnapshot::collectWindows(const vector<size_t>& indexes) {
+    // Send phase.
+    vector<WinCookies> cookies(indexes.size());
+    for (size_t n = 0; n < indexes.size(); n++) {
+        const xcb_window_t window = mWinInfos[indexes[n]].id;
+        WinCookies& c = cookies[n];
+
+        c.attributes = xcb_get_window_attributes(mConnection, window);
+        c.geometry = xcb_get_geometry(mConnection, window);
+        c.coordinates = xcb_translate_coordinates(mConnection,
+            window, mRoot, 0, 0);
+
+        c.name = xcb_get_property(mConnection, 0, window,
+            XCB_ATOM_WM_NAME, XCB_GET_PROPERTY_TYPE_ANY, 0, TITLE_LONGS);
+        c.netName = xcb_get_property(mConnection, 0, window,
+            getAtom(NET_WM_NAME), getAtom(UTF8_STRING), 0, TITLE_LONGS);
+        c.netDesktop = xcb_get_property(mConnection, 0, window,
+            getAtom(NET_WM_DESKTOP), XCB_GET_PROPERTY_TYPE_ANY, 0, 1);
+        c.winWorkspace = xcb_get_property(mConnection, 0, window,
+            getAtom(WIN_WORKSPACE), XCB_GET_PROPERTY_TYPE_ANY, 0, 1);
+        c.netState = xcb_get_property(mConnection, 0, window,
+            getAtom(NET_WM_STATE), XCB_ATOM_ATOM, 0, ATOM_LIST_LONGS);
+        c.windowType = xcb_get_property(mConnection, 0, window,
+            getAtom(NET_WM_WINDOW_TYPE), XCB_ATOM_ATOM, 0,
+            ATOM_LIST_LONGS);
+        c.wmState = xcb_get_property(mConnection, 0, window,
+            getAtom(WM_STATE), XCB_GET_PROPERTY_TYPE_ANY, 0, 1);
+        c.wmClass = xcb_get_property(mConnection, 0, window,
+            XCB_ATOM_WM_CLASS, XCB_ATOM_STRING, 0, CLASS_LONGS);
+        c.netPid = xcb_get_property(mConnection, 0, window,
+            getAtom(NET_WM_PID), XCB_ATOM_CARDINAL, 0, 1);
+    }
+    xcb_flush(mConnection);
+
+    // Gather phase.
+    for (size_t n = 0; n < indexes.size(); n++) {
+        const size_t i = indexes[n];
+        WinCookies& c = cookies[n];
+        WinInfo* winInfoItem = &mWinInfos[i];
+        WinState* winState = &mWinStates[i];
+        xcb_generic_error_t* error = NULL;
+
+        // Attributes & geometry.
+        winState->mapState = -1;
+        winState->visual = 0;
+        xcb_get_window_attributes_reply_t* attributes =
+            (xcb_get_window_attributes_reply_t*) traceWaitForReply(
+                mConnection, c.attributes.sequence, &error,
+                "GetWindowAttributes", winInfoItem->id);
+        free(error);
+        error = NULL;
+        if (attributes) {
+            winState->mapState = attributes->map_state;
+            winState->visual = attributes->visual;
+            free(attributes);
+        }
+
+        winInfoItem->x = -1;
+        winInfoItem->y = -1;
+        winInfoItem->w = -1;
+        winInfoItem->h = -1;
+        winState->depth = 0;
+        xcb_get_geometry_reply_t* geometry = (xcb_get_geometry_reply_t*)
+            traceWaitForReply(mConnection, c.geometry.sequence, &error,
+                "GetGeometry", winInfoItem->id);
+        free(error);
+        error = NULL;
+        if (geometry) {
+            winInfoItem->x = geometry->x;
+            winInfoItem->y = geometry->y;
+            winInfoItem->w = geometry->width;
+            winInfoItem->h = geometry->height;
+            winState->depth = geometry->depth;
+            free(geometry);
+        }
+
+        int xCoord = -1;
+        int yCoord = -1;
+        xcb_translate_coordinates_reply_t* coordinates =
+            (xcb_translate_coordinates_reply_t*) traceWaitForReply(
+                mConnection, c.coordinates.sequence, &error,
+                "TranslateCoordinates", winInfoItem->id);
+        free(error);
+        if (coordinates) {
+            xCoord = coordinates->dst_x;
+            yCoord = coordinates->dst_y;
+            free(coordinates);
+        }
+        winInfoItem->xa = xCoord - winInfoItem->x;
+        winInfoItem->ya = yCoord - winInfoItem->y;
+
+        // Title, UTF-8 _NET_WM_NAME first, else WM_NAME, appended
+        // to the arena ('\0' terminated).
+        xcb_get_property_reply_t* netName = getPropertyReply(
+            mConnection, c.netName, winInfoItem->id);
+        xcb_get_property_reply_t* name = getPropertyReply(
+            mConnection, c.name, winInfoItem->id);
+
+        winInfoItem->titleOffset = mTitleArena.size();
+        if (netName && xcb_get_property_value_length(netName) > 0) {
+            appendPropertyValue(netName, winInfoItem->id,
+                getAtom(NET_WM_NAME), mTitleArena);
+        } else if (name && name->type == XCB_ATOM_STRING) {
+            mPropertyBuffer.clear();
+            appendPropertyValue(name, winInfoItem->id, XCB_ATOM_WM_NAME,
+                mPropertyBuffer);
+            appendLatin1AsUtf8(mTitleArena, mPropertyBuffer.data(),
+                mPropertyBuffer.size());
+        } else if (name) {
+            appendPropertyValue(name, winInfoItem->id, XCB_ATOM_WM_NAME,
+                mTitleArena);
+        }
+        winInfoItem->titleLength = mTitleArena.size() -
+            winInfoItem->titleOffset;
+        mTitleArena += '\0';
+
+        free(netName);
+        free(name);
+
+        // Class & owning process.
+        mClasses[i].clear();
+        xcb_get_property_reply_t* wmClass = getPropertyReply(
+            mConnection, c.wmClass, winInfoItem->id);
+        if (wmClass) {
+            appendPropertyValue(wmClass, winInfoItem->id,
+                XCB_ATOM_WM_CLASS, mClasses[i]);
+            free(wmClass);
+        }
+
+        winInfoItem->pid = 0;
+        xcb_get_property_reply_t* netPid = getPropertyReply(
+            mConnection, c.netPid, winInfoItem->id);
+        getFirstLong(netPid, &winInfoItem->pid);
+        free(netPid);
+
+        // Workspace.
+        xcb_get_property_reply_t* netDesktop = getPropertyReply(
+            mConnection, c.netDesktop, winInfoItem->id);
+        xcb_get_property_reply_t* winWorkspace = getPropertyReply(
+            mConnection, c.winWorkspace, winInfoItem->id);
+        winInfoItem->ws = getWorkspace(netDesktop, winWorkspace);
+        free(netDesktop);
+        free(winWorkspace);
+
+        // State & type.
+        xcb_get_property_reply_t* netState = getPropertyReply(
+            mConnection, c.netState, winInfoItem->id);
+        xcb_get_property_reply_t* windowType = getPropertyReply(
+            mConnection, c.windowType, winInfoItem->id);
+        xcb_get_property_reply_t* wmState = getPropertyReply(
+            mConnection, c.wmState, winInfoItem->id);
+
+        // Needed in KDE and LXDE.
+        mPropertyBuffer.clear();
+        if (isAtomList(netState)) {
+            appendPropertyValue(netState, winInfoItem->id,
+                getAtom(NET_WM_STATE), mPropertyBuffer);
+        }
+        winInfoItem->sticky = winInfoItem->ws == -1 ||
+            hasAtom(mPropertyBuffer, getAtom(NET_WM_STATE_STICKY));
+        winState->netHidden = hasAtom(mPropertyBuffer,
+            getAtom(NET_WM_STATE_HIDDEN));
+
+        mPropertyBuffer.clear();
+        if (isAtomList(windowType)) {
+            appendPropertyValue(windowType, winInfoItem->id,
+                getAtom(NET_WM_WINDOW_TYPE), mPropertyBuffer);
+        }
+        winInfoItem->dock = hasAtom(mPropertyBuffer,
+            getAtom(NET_WM_WINDOW_TYPE_DOCK));
+        winInfoItem->desktop = hasAtom(mPropertyBuffer,
+            getAtom(NET_WM_WINDOW_TYPE_DESKTOP));
+
+        winState->wmState = NormalState;
+        getFirstLong(wmState, &winState->wmState);
+        computeHidden(i);
+
+        free(netState);
+        free(windowType);
+        free(wmState);
+    }
+
+    compactTitles();
+}
+
+/**
+ * Helper walks every stacked Window up to the root's child: one
+ * pipelined QueryTree pass per level of nesting, each only for
+ * the Windows not there yet.
+ */
+void WindowSnapshot::collectTopLevelWindows() {
+    mTopLevelWindows = mStackedWindows;
+
+    vector<size_t> indexes(mStackedWindows.size());
+    for (size_t i = 0; i < indexes.size(); i++) {
+        indexes[i] = i;
+    }
+
+    while (!indexes.empty()) {
+        // Send phase.
+        vector<xcb_query_tree_cookie_t> cookies(indexes.size());
+        for (size_t n = 0; n < indexes.size(); n++) {
+            cookies[n] = xcb_query_tree(mConnection,
+                mTopLevelWindows[indexes[n]]);
+        }
+        xcb_flush(mConnection);
+
+        // Gather phase.
+        vector<size_t> parentIndexes;
+        for (size_t n = 0; n < indexes.size(); n++) {
+            const size_t i = indexes[n];
+            xcb_generic_error_t* error = NULL;
+            xcb_query_tree_reply_t* tree = (xcb_query_tree_reply_t*)
+                traceWaitForReply(mConnection, cookies[n].sequence,
+                    &error, "QueryTree", mTopLevelWindows[i]);
+            free(error);
+
+            if (!tree) {
+                mTopLevelWindows[i] = mStackedWindows[i];
+            } else if (tree->parent != tree->root &&
+                    tree->parent != XCB_NONE) {
+                mTopLevelWindows[i] = tree->parent;
+                parentIndexes.push_back(i);
+            }
+            free(tree);
+        }
+        indexes.swap(parentIndexes);
+    }
+}
+
+/**
+ * Derive a Window's "hidden" attribute from its raw state.
+ */
+void WindowSnapshot::computeHidden(size_t index) {
+    const WinState* winState = &mWinStates[index];
+
+    mWinInfos[index].hidden = !mIsDesktopVisible ||
+        winState->mapState != XCB_MAP_STATE_VIEWABLE ||
+        winState->netHidden ||
+        winState->wmState != NormalState;
+}
+
+/**
+ * Keep the title arena in stacked order with no stale titles,
+ * as the matchers expect. A no-op after a full collect().
+ */
+void WindowSnapshot::compactTitles() {
+    size_t expected = 0;
+    for (size_t i = 0; i < mWinInfos.size(); i++) {
+        if (mWinInfos[i].titleOffset != expected) {
+            break;
+        }
+        expected += mWinInfos[i].titleLength + 1;
+    }
+    if (expected == mTitleArena.size()) {
+        return;
+    }
+
+    string titleArena;
+    titleArena.reserve(mTitleArena.size());
+    for (size_t i = 0; i < mWinInfos.size(); i++) {
+        WinInfo* winInfoItem = &mWinInfos[i];
+        const size_t offset = titleArena.size();
+        titleArena.append(mTitleArena, winInfoItem->titleOffset,
+            winInfoItem->titleLength);
+        titleArena += '\0';
+        winInfoItem->titleOffset = offset;
+    }
+    mTitleArena.swap(titleArena);
+}
+
+/**
+ * Get the stacked Windows list, the showing-desktop state, the
+ * active Window, the current workspace and the supported hints,
+ * in one round trip.
+ */
+bool WindowSnapshot::collectRootState() {
+    xcb_get_property_cookie_t activeCookie = xcb_get_property(
+        mConnection, 0, mRoot, getAtom(NET_ACTIVE_WINDOW),
+        XCB_ATOM_WINDOW, 0, 1);
+    xcb_get_property_cookie_t desktopCookie = xcb_get_property(
+        mConnection, 0, mRoot, getAtom(NET_CURRENT_DESKTOP),
+        XCB_ATOM_CARDINAL, 0, 1);
+    xcb_get_property_cookie_t showingCookie = xcb_get_property(
+        mConnection, 0, mRoot, getAtom(NET_SHOWING_DESKTOP),
+        XCB_GET_PROPERTY_TYPE_ANY, 0, 1);
+    xcb_get_property_cookie_t supportedCookie = xcb_get_property(
+        mConnection, 0, mRoot, getAtom(NET_SUPPORTED),
+        XCB_ATOM_ATOM, 0, PROPERTY_CHUNK_LONGS);
+
+    const bool result = collectStackedWindows(mStackedWindows);
+
+    mSupported.clear();
+    xcb_get_property_reply_t* supported = getPropertyReply(
+        mConnection, supportedCookie, None);
+    if (isAtomList(supported)) {
+        mPropertyBuffer.clear();
+        appendPropertyValue(supported, mRoot, getAtom(NET_SUPPORTED),
+            mPropertyBuffer);
+        mSupported.resize(mPropertyBuffer.size() / 4);
+        for (size_t i = 0; i < mSupported.size(); i++) {
+            xcb_atom_t atom;
+            memcpy(&atom, mPropertyBuffer.data() + i * 4, 4);
+            mSupported[i] = atom;
+        }
+    }
+    free(supported);
+
+    xcb_get_property_reply_t* showing = getPropertyReply(
+        mConnection, showingCookie, None);
+
+    long showingValue = 0;
+    mIsDesktopVisible = !(getFirstLong(showing, &showingValue) &&
+        showingValue == 1);
+    free(showing);
+
+    mActiveWindow = collectActiveWindow(activeCookie);
+    mCurrentDesktop = collectCurrentDesktop(desktopCookie);
+
+    return result;
+}
+
+Window WindowSnapshot::collectActiveWindow(
+        xcb_get_property_cookie_t activeCookie) {
+    xcb_get_property_reply_t* active = getPropertyReply(
+        mConnection, activeCookie, None);
+
+    long activeWindow = None;
+    getFirstLong(active, &activeWindow);
+    free(active);
+
+    return (Window) (uint32_t) activeWindow;
+}
+
+long WindowSnapshot::collectCurrentDesktop(
+        xcb_get_property_cookie_t desktopCookie) {
+    xcb_get_property_reply_t* desktop = getPropertyReply(
+        mConnection, desktopCookie, None);
+
+    long currentDesktop = -1;
+    getFirstLong(desktop, &currentDesktop);
+    free(desktop);
+
+    return currentDesktop;
+}
+
+/**
+ * Get the stacked Windows list, however long.
+ */
+bool WindowSnapshot::collectStackedWindows(vector<Window>& windows) {
+    xcb_get_property_cookie_t stackingCookie = xcb_get_property(
+        mConnection, 0, mRoot, getAtom(NET_CLIENT_LIST_STACKING),
+        XCB_ATOM_WINDOW, 0, PROPERTY_CHUNK_LONGS);
+
+    xcb_get_property_reply_t* stacking = getPropertyReply(
+        mConnection, stackingCookie, None);
+    windows.clear();
+    if (!stacking) {
+        return false;
+    }
+
+    mPropertyBuffer.clear();
+    if (stacking->format == 32) {
+        appendPropertyValue(stacking, mRoot,
+            getAtom(NET_CLIENT_LIST_STACKING), mPropertyBuffer);
+    }
+    free(stacking);
+
+    windows.resize(mPropertyBuffer.size() / 4);
+    for (size_t i = 0; i < windows.size(); i++) {
+        xcb_window_t window;
+        memcpy(&window, mPropertyBuffer.data() + i * 4, 4);
+        windows[i] = window;
+    }
+
+    return true;
+}
+
+/**
+ * Append a property's whole value: the first reply's, then, while
+ * the server reports bytes_after, the rest in bounded chunks,
+ * each read & freed in turn.
+ */
+void WindowSnapshot::appendPropertyValue(xcb_get_property_reply_t* reply,
+        xcb_window_t window, xcb_atom_t property, string& value) {
+    const int length = xcb_get_property_value_length(reply);
+    value.append((const char*) xcb_get_property_value(reply), length);
+
+    // An empty first chunk is a type mismatch, not a start.
+    const xcb_atom_t type = reply->type;
+    uint32_t bytesAfter = reply->bytes_after;
+    uint32_t offset = length;
+    while (length > 0 && bytesAfter > 0 && offset % 4 == 0) {
+        xcb_get_property_reply_t* chunk = getPropertyReply(mConnection,
+            xcb_get_property(mConnection, 0, window, property, type,
+                offset / 4, PROPERTY_CHUNK_LONGS),
+            window == mRoot ? None : window);
+        const int chunkLength = chunk ?
+            xcb_get_property_value_length(chunk) : 0;
+        if (chunkLength == 0 || chunk->type != type) {
+            free(chunk);
+            break;
+        }
+
+        value.append((const char*) xcb_get_property_value(chunk),
+            chunkLength);
+        bytesAfter = chunk->bytes_after;
+        offset += chunkLength;
+        free(chunk);
+    }
+}
+
+/**
+ * Subscribe to every event that can make the snapshot stale.
+ */
+void WindowSnapshot::selectEvents() {
+    Display* display = mDisplayHelper->getDisplay();
+
+    statsCountCall("XSelectInput");
+    XSelectInput(display, mRoot, PropertyChangeMask);
+    for (size_t i = 0; i < mStackedWindows.size(); i++) {
+        selectWindowEvents(mStackedWindows[i]);
+    }
+    syncSelections();
+
+    mIsEventSelected = true;
+}
+
+/**
+ * Selections go out on the Xlib connection, queries on the XCB
+ * one, and the server orders neither against the other: wait for
+ * the selections to take effect before any re-read, or a change
+ * between the two is neither read nor sent as an event.
+ */
+void WindowSnapshot::syncSelections() {
+    statsCountCall("XSync");
+    XSync(mDisplayHelper->getDisplay(), False);
+    statsCountRoundTrip(32);
+}
+
+void WindowSnapshot::selectWindowEvents(Window window) {
+    statsCountCall("XSelectInput");
+    XSelectInput(mDisplayHelper->getDisplay(), window,
+        PropertyChangeMask | StructureNotifyMask);
+}
+
+/**
+ * Changes made before the selections took effect sent no event.
+ */
+void WindowSnapshot::markStale() {
+    mIsStackingDirty = true;
+    mIsShowingDirty = true;
+    mIsActiveDirty = true;
+    mIsCurrentDesktopDirty = true;
+    mDirtyWindows = mStackedWindows;
+}
+
+/**
+ * Note what an X event made stale. Returns true when the
+ * event concerned the snapshot at all.
+ */
+bool WindowSnapshot::handleEvent(const XEvent& event) {
+    Window window = None;
+
+    switch (event.type) {
+        case PropertyNotify:
+            if (event.xproperty.window == mRoot) {
+                if (event.xproperty.atom ==
+                        getAtom(NET_CLIENT_LIST_STACKING)) {
+                    mIsStackingDirty = true;
+                    return true;
+                }
+                if (event.xproperty.atom ==
+                        getAtom(NET_SHOWING_DESKTOP)) {
+                    mIsShowingDirty = true;
+                    return true;
+                }
+                if (event.xproperty.atom ==
+                        getAtom(NET_ACTIVE_WINDOW)) {
+                    mIsActiveDirty = true;
+                    return true;
+                }
+                if (event.xproperty.atom ==
+                        getAtom(NET_CURRENT_DESKTOP)) {
+                    mIsCurrentDesktopDirty = true;
+                    return true;
+                }
+                return false;
+            }
+            window = event.xproperty.window;
+            break;
+
+        case ConfigureNotify:
+            window = event.xconfigure.window;
+            break;
+
+        case MapNotify:
+            window = event.xmap.window;
+            break;
+
+        case UnmapNotify:
+            window = event.xunmap.window;
+            break;
+
+        // A new frame is a new top-level Window.
+        case ReparentNotify:
+            window = event.xreparent.window;
+            break;
+
+        case DestroyNotify:
+            // The WM drops it from the stacking list, too.
+            mIsStackingDirty = true;
+            return true;
+
+        default:
+            return false;
+    }
+
+    if (findWindow(window) < 0) {
+        return false;
+    }
+    if (find(mDirtyWindows.begin(), mDirtyWindows.end(), window) ==
+            mDirtyWindows.end()) {
+        mDirtyWindows.push_back(window);
+    }
+    return true;
+}
+
+/**
+ * Re-read only what events made stale, in one pipelined pass.
+ */
+void WindowSnapshot::update() {
+    vector<size_t> indexes;
+
+    if (mIsStackingDirty || mIsShowingDirty || mIsActiveDirty ||
+            mIsCurrentDesktopDirty || !mDirtyWindows.empty()) {
+        mGeneration++;
+    }
+
+    // Showing desktop affects every Window's hidden attribute,
+    // but needs no per-Window query.
+    if (mIsShowingDirty) {
+        xcb_get_property_reply_t* showing = getPropertyReply(
+            mConnection, xcb_get_property(mConnection, 0, mRoot,
+                getAtom(NET_SHOWING_DESKTOP),
+                XCB_GET_PROPERTY_TYPE_ANY, 0, 1), None);
+
+        long showingValue = 0;
+        mIsDesktopVisible = !(getFirstLong(showing, &showingValue) &&
+            showingValue == 1);
+        free(showing);
+
+        for (size_t i = 0; i < mWinInfos.size(); i++) {
+            computeHidden(i);
+        }
+        mIsShowingDirty = false;
+    }
+
+    if (mIsActiveDirty) {
+        mActiveWindow = collectActiveWindow(xcb_get_property(
+            mConnection, 0, mRoot, getAtom(NET_ACTIVE_WINDOW),
+            XCB_ATOM_WINDOW, 0, 1));
+        mIsActiveDirty = false;
+    }
+
+    if (mIsCurrentDesktopDirty) {
+        mCurrentDesktop = collectCurrentDesktop(xcb_get_property(
+            mConnection, 0, mRoot, getAtom(NET_CURRENT_DESKTOP),
+            XCB_ATOM_CARDINAL, 0, 1));
+        mIsCurrentDesktopDirty = false;
+    }
+
+    // Re-order existing entries to the new stacking order;
+    // only Windows new to the list are queried.
+    if (mIsStackingDirty) {
+        vector<Window> windows;
+        collectStackedWindows(windows);
+
+        unordered_map<Window, size_t> oldIndexes;
+        for (size_t i = 0; i < mStackedWindows.size(); i++) {
+            oldIndexes[mStackedWindows[i]] = i;
+        }
+
+        vector<WinInfo> winInfos(windows.size());
+        vector<WinState> winStates(windows.size());
+        vector<string> classes(windows.size());
+        for (size_t i = 0; i < windows.size(); i++) {
+            auto old = oldIndexes.find(windows[i]);
+            if (old == oldIndexes.end()) {
+                winInfos[i].id = windows[i];
+                indexes.push_back(i);
+                if (mIsEventSelected) {
+                    selectWindowEvents(windows[i]);
+                }
+                continue;
+            }
+            winInfos[i] = mWinInfos[old->second];
+            winStates[i] = mWinStates[old->second];
+            classes[i].swap(mClasses[old->second]);
+        }
+
+        mStackedWindows.swap(windows);
+        mWinInfos.swap(winInfos);
+        mWinStates.swap(winStates);
+        mClasses.swap(classes);
+        mIsStackingDirty = false;
+
+        // New Windows' selections, before their first read.
+        if (mIsEventSelected && !indexes.empty()) {
+            syncSelections();
+        }
+    }
+
+    for (size_t i = 0; i < mDirtyWindows.size(); i++) {
+        const int index = findWindow(mDirtyWindows[i]);
+        if (index >= 0 && find(indexes.begin(), indexes.end(),
+                (size_t) index) == indexes.end()) {
+            indexes.push_back(index);
+        }
+    }
+    mDirtyWindows.clear();
+
+    if (!indexes.empty()) {
+        collectWindows(indexes);
+    }
+    compactTitles();
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+/**
+ * Snapshot of the stacked x11 Windows and root state, collected
+ * once per invocation in one pipelined pass over an XCB
+ * connection, and shared by all verbs & matchers.
+ *
+ * A long-lived snapshot (daemon) can be kept current from X
+ * events instead of being re-collected.
+ */
+
+// Std C and c++.
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+// X11.
+#include <X11/Xlib.h>
+#include <xcb/xcb.h>
+
+// Application.
+#include "dox11Types.h"
+#include "xDisplayHelper.h"
+
+/**
+ * Class def.
+ */
+class WindowSnapshot {
+    public:
+        WindowSnapshot(xDisplayHelper*);
+
+        bool collect();
+        bool collectWorkspace(long workspace);
+
+        size_t size();
+        WinInfo* getInfo(size_t index);
+        string_view getTitle(size_t index);
+        const string& getClass(size_t index);
+        int findWindow(Window);
+
+        // All UTF-8 titles in stacked order, each '\0' terminated.
+        const string& getTitleArena();
+        size_t findTitleIndex(size_t offset);
+
+        const vector<Window>& getStackedWindows();
+        bool isDesktopVisible();
+        bool isSupported(X_ATOM);
+        Window getActiveWindow();
+        long getCurrentDesktop();    // -1 if unknown.
+        int getRootWidth();
+        int getRootHeight();
+
+        // Changes whenever the snapshot does, for derived data.
+        unsigned long getGeneration();
+
+        const vector<size_t>& getWorkspaceWindows(long workspace);
+
+        // The root's child holding a stacked Window (its frame
+        // under a reparenting window manager); others as is.
+        Window getTopLevelWindow(Window);
+
+        // Depth & VisualID, or 0 if unknown.
+        void getPixelFormat(size_t index, int* depth,
+            unsigned long* visual);
+
+        // For layout, read now in one round trip: the frames of
+        // some Windows, and the current workspace's work area.
+        void collectLayoutState(const vector<size_t>& indexes,
+            vector<FrameExtents>& frames, LayoutRect* workArea);
+
+        // Event maintenance.
+        void selectEvents();
+        bool handleEvent(const XEvent&);
+
+        // Have the next update() re-read everything: after
+        // selectEvents(), for changes that came before it.
+        void markStale();
+        void update();
+
+    private:
+        // Raw per-Window state that "hidden" is derived from, and
+        // the pixel format, for capture.
+        typedef struct {
+            int mapState;
+            bool netHidden;
+            long wmState;
+            int depth;
+            unsigned long visual;
+        } WinState;
+
+        xcb_atom_t getAtom(X_ATOM);
+        bool collectStart();
+        bool collectRootState();
+        Window collectActiveWindow(xcb_get_property_cookie_t);
+        long collectCurrentDesktop(xcb_get_property_cookie_t);
+        bool collectStackedWindows(vector<Window>&);
+        void appendPropertyValue(xcb_get_property_reply_t*,
+            xcb_window_t, xcb_atom_t property, string& value);
+        void collectWindows(const vector<size_t>& indexes);
+        void collectTopLevelWindows();
+        void computeHidden(size_t index);
+        void compactTitles();
+        void selectWindowEvents(Window);
+        void syncSelections();
+
+        xDisplayHelper* mDisplayHelper;
+        xcb_connection_t* mConnection;
+        xcb_window_t mRoot;
+
+        // Root state.
+        vector<Window> mStackedWindows;
+        bool mIsDesktopVisible;
+        vector<Atom> mSupported;
+        Window mActiveWindow;
+        long mCurrentDesktop;
+        unsigned long mGeneration;
+
+        // Stacked indexes by workspace, as of mWorkspaceGeneration.
+        unordered_map<long, vector<size_t>> mWorkspaceIndexes;
+        unsigned long mWorkspaceGeneration;
+
+        // Stacked indexes by Window, as of mWindowGeneration.
+        unordered_map<Window, size_t> mWindowIndexes;
+        unsigned long mWindowGeneration;
+
+        // Stacked Windows' top-level ancestors, as of
+        // mTopLevelGeneration.
+        vector<Window> mTopLevelWindows;
+        unsigned long mTopLevelGeneration;
+
+        // Stacked order, bottom-most first.
+        vector<WinInfo> mWinInfos;
+        vector<WinState> mWinStates;
+        vector<string> mClasses;
+        string mTitleArena;
+
+        // Reused for property values read in chunks.
+        string mPropertyBuffer;
+
+        // Pending event work, applied by update().
+        bool mIsEventSelected;
+        bool mIsStackingDirty;
+        bool mIsShowingDirty;
+        bool mIsActiveDirty;
+        bool mIsCurrentDesktopDirty;
+        vector<Window> mDirtyWindows;
+};
@@ -4,29 +4,83 @@
  */
 
 // Std C and c++.
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <fnmatch.h>
 
 using namespace std;
 
 // X11.
 #include <X11/Xlib.h>
+#include <xcb/xcb.h>
 
 // Application.
 #include "xDisplayHelper.h"
+#include "xStats.h"
+#include "xTrace.h"
+
+
+/**
+ * Module globals.
+ */
+
+// Indexed by X_ATOM.
+static const char* X_ATOM_NAMES[X_ATOM_COUNT] = {
+    "_NET_CLIENT_LIST_STACKING",
+    "_NET_SHOWING_DESKTOP",
+    "_NET_WM_DESKTOP",
+    "_WIN_WORKSPACE",
+    "_NET_WM_STATE",
+    "_NET_WM_STATE_STICKY",
+    "_NET_WM_STATE_HIDDEN",
+    "_NET_WM_WINDOW_TYPE",
+    "_NET_WM_WINDOW_TYPE_DOCK",
+    "_NET_WM_WINDOW_TYPE_DESKTOP",
+    "WM_STATE",
+    "_NET_SUPPORTED",
+    "_NET_RESTACK_WINDOW",
+    "_NET_WM_PID",
+    "_NET_WM_NAME",
+    "UTF8_STRING",
+    "_NET_ACTIVE_WINDOW",
+    "_NET_CURRENT_DESKTOP",
+    "_NET_FRAME_EXTENTS",
+    "_NET_WORKAREA",
+    "_NET_MOVERESIZE_WINDOW"
+};
 
 
 /**
  * Class instantiation.
  */
-xDisplayHelper::xDisplayHelper() {
+xDisplayHelper::xDisplayHelper(const char* displayName) {
     mDisplay = nullptr;
+    mXcbConnection = nullptr;
     mSessionType = nullptr;
+    mRoot = None;
+    mScreenWidth = 0;
+    mScreenHeight = 0;
+    fill(mAtoms, mAtoms + X_ATOM_COUNT, None);
 
-    // Check for display error.
+    // A replayed display is the recorded one, over a dead XCB
+    // connection: requests go nowhere, the trace answers.
+    if (isTraceReplaying()) {
+        getTraceDisplay(&mRoot, &mScreenWidth, &mScreenHeight, mAtoms,
+            X_ATOM_COUNT);
+        mXcbConnection = xcb_connect_to_fd(-1, NULL);
+        return;
+    }
+
+    // Check for display error. A display asked for by name is
+    // taken as X11, whatever this session is.
     const char* WAYLAND_DISPLAY = getenv("WAYLAND_DISPLAY");
-    if (WAYLAND_DISPLAY && strlen(WAYLAND_DISPLAY) > 0) {
+    if (!displayName && WAYLAND_DISPLAY && strlen(WAYLAND_DISPLAY) > 0) {
         //const char* TEMP = WAYLAND_DISPLAY ?
         //    WAYLAND_DISPLAY : "";
         //cout << XCOLOR_RED << endl << "xDisplayHelper: Wayland "
@@ -38,9 +92,10 @@ xDisplayHelper::xDisplayHelper() {
         return;
     }
 
-    // Check for session error.
+    // Check for session error. Unset (ssh, Xvfb, cron) is let
+    // through to XOpenDisplay.
     mSessionType = getenv("XDG_SESSION_TYPE");
-    if (strcmp(mSessionType, "x11") != 0) {
+    if (!displayName && mSessionType && strcmp(mSessionType, "x11") != 0) {
         //cout << endl << XCOLOR_RED << "xDisplayHelper: No X11 "
         //    "Session type is detected, FATAL." <<
         //    XCOLOR_NORMAL << endl;
@@ -51,19 +106,136 @@ xDisplayHelper::xDisplayHelper() {
     }
 
     // Check for display access.
-    mDisplay = XOpenDisplay(NULL);
+    statsCountCall("XOpenDisplay");
+    mDisplay = XOpenDisplay(displayName);
     //if (mDisplay == NULL) {
         //cout << XCOLOR_RED << "xDisplayHelper: X11 Display "
         //    "does not seem to be available (Are you Wayland?) "
         //    "FATAL." << XCOLOR_NORMAL << endl;
     //  return;
     //}
+
+    if (mDisplay) {
+        mRoot = DefaultRootWindow(mDisplay);
+        mScreenWidth = DisplayWidth(mDisplay, DefaultScreen(mDisplay));
+        mScreenHeight = DisplayHeight(mDisplay, DefaultScreen(mDisplay));
+    }
+
+    // Intern every atom we use, in one round trip.
+    if (mDisplay) {
+        statsCountCall("XInternAtoms");
+        XInternAtoms(mDisplay, (char**) X_ATOM_NAMES, X_ATOM_COUNT,
+            False, mAtoms);
+        statsCountRoundTrip(X_ATOM_COUNT * 32);
+    }
+
+    // Second connection to the same display, for pipelined
+    // (cookie based) queries.
+    if (mDisplay) {
+        statsCountCall("xcb_connect");
+        mXcbConnection = xcb_connect(DisplayString(mDisplay), NULL);
+        if (xcb_connection_has_error(mXcbConnection)) {
+            xcb_disconnect(mXcbConnection);
+            mXcbConnection = nullptr;
+        }
+    }
+
+    // Both connection setups read the same server setup block.
+    if (mXcbConnection) {
+        const size_t setupBytes = 8 +
+            4 * xcb_get_setup(mXcbConnection)->length;
+        statsCountRoundTrip(setupBytes);
+        statsCountRoundTrip(setupBytes);
+    }
+}
+
+xDisplayHelper::~xDisplayHelper() {
+    if (mXcbConnection) {
+        xcb_disconnect(mXcbConnection);
+    }
+    if (mDisplay) {
+        XCloseDisplay(mDisplay);
+    }
 }
 
 Display* xDisplayHelper::getDisplay() {
     return mDisplay;
 }
 
+xcb_connection_t* xDisplayHelper::getXcbConnection() {
+    return mXcbConnection;
+}
+
 char* xDisplayHelper::getSessionType() {
     return mSessionType;
 }
+
+Window xDisplayHelper::getRoot() {
+    return mRoot;
+}
+
+int xDisplayHelper::getScreenWidth() {
+    return mScreenWidth;
+}
+
+int xDisplayHelper::getScreenHeight() {
+    return mScreenHeight;
+}
+
+Atom xDisplayHelper::getAtom(X_ATOM atom) {
+    return mAtoms[atom];
+}
+
+/**
+ * Expand a --display list: comma separated names (":1",
+ * "host:0.1") and globs (":*", ":1?") matched against the local
+ * servers' /tmp/.X11-unix sockets. In order, without repeats.
+ */
+vector<string> getDisplayNames(const string& list) {
+    vector<string> localNames;
+    DIR* socketDir = opendir("/tmp/.X11-unix");
+    if (socketDir) {
+        for (dirent* entry = readdir(socketDir); entry;
+                entry = readdir(socketDir)) {
+            if (entry->d_name[0] == 'X' && entry->d_name[1]) {
+                localNames.push_back(string(":") + (entry->d_name + 1));
+            }
+        }
+        closedir(socketDir);
+    }
+    sort(localNames.begin(), localNames.end(),
+        [](const string& a, const string& b) {
+            return atoi(a.c_str() + 1) < atoi(b.c_str() + 1);
+        });
+
+    vector<string> names;
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = list.find(',', start);
+        if (end == string::npos) {
+            end = list.size();
+        }
+        const string pattern = list.substr(start, end - start);
+        start = end + 1;
+
+        vector<string> matches;
+        if (pattern.find_first_of("*?[") == string::npos) {
+            matches.push_back(pattern);
+        } else {
+            for (size_t i = 0; i < localNames.size(); i++) {
+                if (fnmatch(pattern.c_str(), localNames[i].c_str(),
+                        0) == 0) {
+                    matches.push_back(localNames[i]);
+                }
+            }
+        }
+
+        for (size_t i = 0; i < matches.size(); i++) {
+            if (!matches[i].empty() && find(names.begin(), names.end(),
+                    matches[i]) == names.end()) {
+                names.push_back(matches[i]);
+            }
+        }
+    }
+    return names;
+}
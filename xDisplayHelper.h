@@ -6,22 +6,75 @@
  */
 
 // Std C and c++.
+#include <string>
+#include <vector>
+
+using namespace std;
 
 // X11.
 #include <X11/Xlib.h>
+#include <xcb/xcb.h>
+
+/**
+ * Atoms interned once, at connect time.
+ */
+enum X_ATOM {
+    NET_CLIENT_LIST_STACKING,
+    NET_SHOWING_DESKTOP,
+    NET_WM_DESKTOP,
+    WIN_WORKSPACE,
+    NET_WM_STATE,
+    NET_WM_STATE_STICKY,
+    NET_WM_STATE_HIDDEN,
+    NET_WM_WINDOW_TYPE,
+    NET_WM_WINDOW_TYPE_DOCK,
+    NET_WM_WINDOW_TYPE_DESKTOP,
+    WM_STATE,
+    NET_SUPPORTED,
+    NET_RESTACK_WINDOW,
+    NET_WM_PID,
+    NET_WM_NAME,
+    UTF8_STRING,
+    NET_ACTIVE_WINDOW,
+    NET_CURRENT_DESKTOP,
+    NET_FRAME_EXTENTS,
+    NET_WORKAREA,
+    NET_MOVERESIZE_WINDOW,
+    X_ATOM_COUNT
+};
 
 /**
  * Class def.
  */
 class xDisplayHelper {
     public:
-        xDisplayHelper();
+        // NULL for $DISPLAY.
+        xDisplayHelper(const char* displayName = NULL);
         ~xDisplayHelper();
 
+        // NULL when replaying a trace; the rest still holds.
         Display* getDisplay();
+        xcb_connection_t* getXcbConnection();
         char* getSessionType();
 
+        Window getRoot();
+        int getScreenWidth();
+        int getScreenHeight();
+
+        Atom getAtom(X_ATOM);
+
     private:
         Display* mDisplay;
+        xcb_connection_t* mXcbConnection;
         char* mSessionType;
+
+        Window mRoot;
+        int mScreenWidth;
+        int mScreenHeight;
+        Atom mAtoms[X_ATOM_COUNT];
 };
+
+/**
+ * Module Method stubs.
+ */
+vector<string> getDisplayNames(const string& list);
@@ -0,0 +1,240 @@
+/**
+ * --stats protocol instrumentation: X calls, blocking round
+ * trips, bytes received, errors & elapsed time, per phase.
+ *
+ * A reply counts as a blocking round trip only when it was not
+ * already read; pipelined replies waiting in the queue are free.
+ */
+
+// Std C and c++.
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+// X11.
+#include <X11/Xlib.h>
+#include <xcb/xcb.h>
+#include <xcb/xcbext.h>
+
+// Application.
+#include "dox11Types.h"
+#include "outputWriter.h"
+#include "xStats.h"
+
+
+/**
+ * Module Types, Enums, & Defines.
+ */
+typedef struct {
+    unordered_map<string_view, unsigned long> calls;
+    unsigned long roundTrips;
+    unsigned long bytesReceived;
+    chrono::steady_clock::duration elapsed;
+} PhaseStats;
+
+#define X_REPLY_HEADER_LENGTH 32
+
+
+/**
+ * Module globals. Per thread: each display's worker (--display=LIST)
+ * keeps its own.
+ */
+static thread_local bool mIsStatsEnabled = false;
+static thread_local STATS_PHASE mPhase = STATS_CONNECT;
+static thread_local chrono::steady_clock::time_point mPhaseStart;
+static thread_local PhaseStats mPhaseStats[STATS_PHASE_COUNT];
+static thread_local map<int, unsigned long> mErrorCounts;
+
+// The single largest per-Window reply, to spot one
+// pathological Window.
+static thread_local size_t mLargestReplyBytes = 0;
+static thread_local const char* mLargestReplyName = "";
+static thread_local Window mLargestReplyWindow = None;
+
+static const char* PHASE_NAMES[STATS_PHASE_COUNT] = {
+    "connect", "enumerate", "match", "act"
+};
+
+
+/**
+ * Module helpers.
+ */
+static void countBytes(size_t bytes, const char* name, Window window) {
+    mPhaseStats[mPhase].bytesReceived += bytes;
+    if (window != None && bytes > mLargestReplyBytes) {
+        mLargestReplyBytes = bytes;
+        mLargestReplyName = name;
+        mLargestReplyWindow = window;
+    }
+}
+
+static void writeMilliseconds(OutputWriter& out,
+        chrono::steady_clock::duration elapsed) {
+    const long micros = chrono::duration_cast<chrono::microseconds>(
+        elapsed).count();
+    out.appendNumber(micros / 1000, 9, false);
+    out << '.';
+    const long fraction = micros % 1000;
+    out << (fraction < 100 ? "0" : "") << (fraction < 10 ? "0" : "") <<
+        fraction;
+}
+
+
+void statsEnable() {
+    mIsStatsEnabled = true;
+    mPhase = STATS_CONNECT;
+    mPhaseStart = chrono::steady_clock::now();
+}
+
+/**
+ * Charge the time so far to the current phase, and switch.
+ */
+STATS_PHASE statsSetPhase(STATS_PHASE phase) {
+    const STATS_PHASE previous = mPhase;
+    if (mIsStatsEnabled) {
+        const chrono::steady_clock::time_point now =
+            chrono::steady_clock::now();
+        mPhaseStats[mPhase].elapsed += now - mPhaseStart;
+        mPhaseStart = now;
+    }
+    mPhase = phase;
+    return previous;
+}
+
+void statsCountCall(const char* name) {
+    if (mIsStatsEnabled) {
+        mPhaseStats[mPhase].calls[name]++;
+    }
+}
+
+void statsCountRoundTrip(size_t bytesReceived) {
+    if (mIsStatsEnabled) {
+        mPhaseStats[mPhase].roundTrips++;
+        mPhaseStats[mPhase].bytesReceived += bytesReceived;
+    }
+}
+
+void statsCountError(int errorCode) {
+    if (mIsStatsEnabled) {
+        mErrorCounts[errorCode]++;
+    }
+}
+
+void* statsWaitForReply(xcb_connection_t* connection,
+        unsigned int sequence, xcb_generic_error_t** error,
+        const char* name, Window window, bool* isBlocked) {
+    if (!mIsStatsEnabled && !isBlocked) {
+        return xcb_wait_for_reply(connection, sequence, error);
+    }
+
+    void* reply = NULL;
+    const bool isRoundTrip = !xcb_poll_for_reply(connection, sequence,
+        &reply, error);
+    if (isRoundTrip) {
+        reply = xcb_wait_for_reply(connection, sequence, error);
+    }
+    if (isBlocked) {
+        *isBlocked = isRoundTrip;
+    }
+
+    size_t bytes = 0;
+    if (reply) {
+        bytes = X_REPLY_HEADER_LENGTH + 4 *
+            ((xcb_generic_reply_t*) reply)->length;
+    }
+    if (*error) {
+        bytes = X_REPLY_HEADER_LENGTH;
+        statsCountError((*error)->error_code);
+    }
+    statsCountReply(name, window, bytes, isRoundTrip);
+    return reply;
+}
+
+void statsCountReply(const char* name, Window window, size_t bytes,
+        bool isRoundTrip) {
+    if (!mIsStatsEnabled) {
+        return;
+    }
+
+    mPhaseStats[mPhase].calls[name]++;
+    if (isRoundTrip) {
+        mPhaseStats[mPhase].roundTrips++;
+    }
+    countBytes(bytes, name, window);
+}
+
+/**
+ * The report, one block per phase, then errors by code.
+ */
+void statsWrite(OutputWriter& out, Display* display) {
+    statsSetPhase(mPhase);
+
+    out << COLOR_BLUE << "\ndox11cmd: Stats" << COLOR_NORMAL << "\n";
+    out << COLOR_GREEN << "\nphase / call                    calls  "
+        "round trips      bytes     elapsed ms" << COLOR_NORMAL << "\n";
+
+    for (int phase = 0; phase < STATS_PHASE_COUNT; phase++) {
+        const PhaseStats& stats = mPhaseStats[phase];
+
+        unsigned long callCount = 0;
+        vector<pair<string_view, unsigned long>> calls(
+            stats.calls.begin(), stats.calls.end());
+        sort(calls.begin(), calls.end());
+        for (size_t i = 0; i < calls.size(); i++) {
+            callCount += calls[i].second;
+        }
+
+        const string_view phaseName = PHASE_NAMES[phase];
+        out << phaseName << string(28 - phaseName.size(), ' ');
+        out.appendNumber(callCount, 9, false);
+        out.appendNumber(stats.roundTrips, 13, false);
+        out.appendNumber(stats.bytesReceived, 11, false);
+        out << "  ";
+        writeMilliseconds(out, stats.elapsed);
+        out << "\n";
+
+        for (size_t i = 0; i < calls.size(); i++) {
+            out << "   " << calls[i].first;
+            out.appendNumber(calls[i].second,
+                34 - (int) calls[i].first.size(), false);
+            out << "\n";
+        }
+    }
+
+    if (mLargestReplyBytes > 0) {
+        out << "\nlargest Window reply: ";
+        out.appendHex(mLargestReplyWindow, 8);
+        out << " " << mLargestReplyName << " " << mLargestReplyBytes <<
+            " bytes\n";
+    }
+
+    for (auto error = mErrorCounts.begin(); error != mErrorCounts.end();
+            error++) {
+        char message[MAX_ERROR_MESSAGE_LENGTH] = "";
+        if (display) {
+            XGetErrorText(display, error->first, message,
+                sizeof(message));
+        }
+        out << COLOR_RED << "error " << error->first << " " << message <<
+            ": " << error->second << COLOR_NORMAL << "\n";
+    }
+}
+
+
+/**
+ * Class instantiation.
+ */
+StatsPhase::StatsPhase(STATS_PHASE phase) {
+    mPrevious = statsSetPhase(phase);
+}
+
+StatsPhase::~StatsPhase() {
+    statsSetPhase(mPrevious);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+/**
+ * --stats protocol instrumentation: X calls, blocking round
+ * trips, bytes received, errors & elapsed time, per phase.
+ *
+ * Everything is a no-op until statsEnable().
+ */
+
+// Std C and c++.
+#include <cstddef>
+
+// X11.
+#include <X11/Xlib.h>
+#include <xcb/xcb.h>
+
+// Application.
+#include "outputWriter.h"
+
+/**
+ * Module Types, Enums, & Defines.
+ */
+enum STATS_PHASE {
+    STATS_CONNECT,
+    STATS_ENUMERATE,
+    STATS_MATCH,
+    STATS_ACT,
+    STATS_PHASE_COUNT
+};
+
+/**
+ * Module Method stubs.
+ */
+void statsEnable();
+STATS_PHASE statsSetPhase(STATS_PHASE);
+
+// Names are string literals.
+void statsCountCall(const char* name);
+void statsCountRoundTrip(size_t bytesReceived);
+void statsCountError(int errorCode);
+
+// xcb_wait_for_reply(), counting the request, whether it had
+// to block, and the reply (or error) size. Window is None for
+// root & other not per-Window requests. isBlocked, if given, is
+// set (even with stats off).
+void* statsWaitForReply(xcb_connection_t*, unsigned int sequence,
+    xcb_generic_error_t**, const char* name, Window,
+    bool* isBlocked = NULL);
+
+// Count a reply (or error) got some other way, as above.
+void statsCountReply(const char* name, Window, size_t bytes,
+    bool isRoundTrip);
+
+void statsWrite(OutputWriter&, Display*);
+
+/**
+ * Class def: scoped phase, restoring the previous one.
+ */
+class StatsPhase {
+    public:
+        StatsPhase(STATS_PHASE);
+        ~StatsPhase();
+
+    private:
+        STATS_PHASE mPrevious;
+};
@@ -0,0 +1,254 @@
+/**
+ * Record & replay of the X replies a run waits for.
+ *
+ * Replay relies on the snapshot being deterministic: given the
+ * same replies, it waits for the same requests in the same
+ * order. Each entry keeps the request name & Window, so a trace
+ * from another version is caught at the first difference rather
+ * than misread.
+ */
+
+// Std C and c++.
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+// X11.
+#include <X11/Xlib.h>
+#include <xcb/xcb.h>
+
+// Application.
+#include "dox11Types.h"
+#include "outputWriter.h"
+#include "xDisplayHelper.h"
+#include "xStats.h"
+#include "xTrace.h"
+
+
+/**
+ * Module Types, Enums, & Defines.
+ */
+#define X_REPLY_HEADER_LENGTH 32
+
+
+/**
+ * Module globals. One display only; --display=LIST is refused.
+ */
+static OutputWriter* mRecordOut = NULL;
+static int mRecordFd = -1;
+
+static bool mIsReplaying = false;
+static string mTrace;
+static size_t mTracePosition = 0;
+static bool mIsDiverged = false;
+static unsigned long mEntryCount = 0;
+static chrono::milliseconds mLatency(0);
+
+
+/**
+ * Module helpers.
+ */
+
+// Note the first wait the trace can't answer, once.
+static void diverge(const char* name, Window window) {
+    if (mIsDiverged) {
+        return;
+    }
+    mIsDiverged = true;
+
+    OutputWriter errorOut(STDERR_FILENO);
+    errorOut << COLOR_RED << "dox11cmd: The trace ends or differs at "
+        "wait " << mEntryCount + 1 << ", " << name << " ";
+    errorOut.appendHex(window, 8);
+    errorOut << "." << COLOR_NORMAL << "\n";
+}
+
+
+/**
+ * Start recording, with what replay needs of the display.
+ */
+bool traceRecord(const string& path, Window root, int width, int height,
+        const Atom* atoms, int atomCount, OutputWriter& out) {
+    mRecordFd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC |
+        O_CLOEXEC, 0600);
+    if (mRecordFd < 0) {
+        out << COLOR_RED << "\ndox11cmd: Cannot write " << path << ": " <<
+            strerror(errno) << "." << COLOR_NORMAL << "\n";
+        return false;
+    }
+    mRecordOut = new OutputWriter(mRecordFd);
+
+    TraceHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = TRACE_MAGIC;
+    header.version = TRACE_VERSION;
+    header.atomCount = atomCount;
+    header.root = root;
+    header.width = width;
+    header.height = height;
+    mRecordOut->write(&header, sizeof(header));
+
+    for (int i = 0; i < atomCount; i++) {
+        const uint32_t atom = atoms[i];
+        mRecordOut->write(&atom, sizeof(atom));
+    }
+    return true;
+}
+
+/**
+ * Load a trace to answer from, whole.
+ */
+bool traceReplay(const string& path, long latencyMilliseconds,
+        OutputWriter& out) {
+    ifstream file(path, ios::binary);
+    mTrace.assign(istreambuf_iterator<char>(file),
+        istreambuf_iterator<char>());
+
+    TraceHeader header;
+    if (!file.is_open() || mTrace.size() < sizeof(header)) {
+        out << COLOR_RED << "\ndox11cmd: Cannot read the trace " <<
+            path << "." << COLOR_NORMAL << "\n";
+        return false;
+    }
+    memcpy(&header, mTrace.data(), sizeof(header));
+    if (header.magic != TRACE_MAGIC || header.version != TRACE_VERSION ||
+            header.atomCount != X_ATOM_COUNT ||
+            mTrace.size() < sizeof(header) + 4 * header.atomCount) {
+        out << COLOR_RED << "\ndox11cmd: " << path << " is not a "
+            "trace, or is another version." << COLOR_NORMAL << "\n";
+        return false;
+    }
+
+    mTracePosition = sizeof(header) + 4 * header.atomCount;
+    mIsReplaying = true;
+    mLatency = chrono::milliseconds(latencyMilliseconds);
+    return true;
+}
+
+void traceFinish() {
+    if (mRecordOut) {
+        delete mRecordOut;
+        mRecordOut = NULL;
+        close(mRecordFd);
+        mRecordFd = -1;
+    }
+}
+
+bool isTraceReplaying() {
+    return mIsReplaying;
+}
+
+/**
+ * The recorded display: root, size & atoms, as xDisplayHelper
+ * would have found them.
+ */
+bool getTraceDisplay(Window* root, int* width, int* height,
+        Atom* atoms, int atomCount) {
+    TraceHeader header;
+    memcpy(&header, mTrace.data(), sizeof(header));
+    if (header.atomCount != atomCount ||
+            mTrace.size() < sizeof(header) + 4 * atomCount) {
+        return false;
+    }
+
+    *root = header.root;
+    *width = header.width;
+    *height = header.height;
+    for (int i = 0; i < atomCount; i++) {
+        uint32_t atom;
+        memcpy(&atom, mTrace.data() + sizeof(header) + 4 * i, 4);
+        atoms[i] = atom;
+    }
+    return true;
+}
+
+/**
+ * One round trip's worth of the injected latency.
+ */
+void traceSleep() {
+    if (mLatency.count() > 0) {
+        this_thread::sleep_for(mLatency);
+    }
+}
+
+/**
+ * A reply (or error) as statsWaitForReply() gives it, from or to
+ * the trace. Replies are malloc()ed, for the caller to free().
+ */
+void* traceWaitForReply(xcb_connection_t* connection,
+        unsigned int sequence, xcb_generic_error_t** error,
+        const char* name, Window window) {
+    const uint16_t nameLength = strlen(name);
+
+    if (!mIsReplaying) {
+        bool isBlocked = false;
+        void* reply = statsWaitForReply(connection, sequence, error,
+            name, window, mRecordOut ? &isBlocked : NULL);
+        if (!mRecordOut) {
+            return reply;
+        }
+
+        const void* data = reply ? reply : (void*) *error;
+        TraceEntry entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.kind = reply ? TRACE_REPLY : *error ? TRACE_ERROR :
+            TRACE_NONE;
+        entry.isBlocked = isBlocked;
+        entry.nameLength = nameLength;
+        entry.window = window;
+        entry.length = reply ? X_REPLY_HEADER_LENGTH + 4 *
+            ((xcb_generic_reply_t*) reply)->length :
+            *error ? sizeof(xcb_generic_error_t) : 0;
+        mRecordOut->write(&entry, sizeof(entry));
+        mRecordOut->write(name, nameLength);
+        mRecordOut->write(data, entry.length);
+        return reply;
+    }
+
+    // Replay, checking the trace waited for the same thing.
+    TraceEntry entry;
+    if (mIsDiverged || mTrace.size() - mTracePosition < sizeof(entry)) {
+        diverge(name, window);
+        return NULL;
+    }
+    memcpy(&entry, mTrace.data() + mTracePosition, sizeof(entry));
+
+    const size_t dataStart = mTracePosition + sizeof(entry) +
+        entry.nameLength;
+    if (mTrace.size() < dataStart + entry.length ||
+            entry.window != window ||
+            mTrace.compare(mTracePosition + sizeof(entry),
+                entry.nameLength, name) != 0) {
+        diverge(name, window);
+        return NULL;
+    }
+    mTracePosition = dataStart + entry.length;
+    mEntryCount++;
+
+    if (entry.isBlocked) {
+        traceSleep();
+    }
+    statsCountReply(name, window, entry.length, entry.isBlocked);
+
+    if (entry.kind == TRACE_NONE) {
+        return NULL;
+    }
+    void* data = malloc(entry.length);
+    memcpy(data, mTrace.data() + dataStart, entry.length);
+    if (entry.kind == TRACE_ERROR) {
+        *error = (xcb_generic_error_t*) data;
+        statsCountError((*error)->error_code);
+        return NULL;
+    }
+    return data;
+}
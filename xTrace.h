@@ -0,0 +1,76 @@
+#pragma once
+
+/**
+ * Record & replay of the X replies a run waits for, so verbs can
+ * be run & timed again with no X server.
+ *
+ * --record=FILE writes the display's root, size & atoms, then
+ * every reply (or error) in the order it was waited for.
+ * --replay=FILE answers the same waits from FILE, in the same
+ * order, over a dead XCB connection whose requests go nowhere.
+ * --latency=MS adds MS to each wait that blocked when recorded,
+ * as --stats counts round trips.
+ */
+
+// Std C and c++.
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+// X11.
+#include <X11/Xlib.h>
+#include <xcb/xcb.h>
+
+// Application.
+#include "outputWriter.h"
+
+/**
+ * Module Types, Enums, & Defines.
+ */
+#define TRACE_MAGIC 0x54584f44 // "DOXT".
+#define TRACE_VERSION 1
+
+// File header, native byte order; then atomCount 32 bit atoms,
+// then the entries.
+typedef struct {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t atomCount;
+        uint32_t root;
+        uint32_t width, height;
+} TraceHeader;
+
+#define TRACE_NONE 0
+#define TRACE_REPLY 1
+#define TRACE_ERROR 2
+
+// One wait: then nameLength bytes of name, length bytes of data.
+typedef struct {
+        uint8_t kind;      // TRACE_*.
+        uint8_t isBlocked;
+        uint16_t nameLength;
+        uint32_t window;
+        uint32_t length;
+} TraceEntry;
+
+static_assert(sizeof(TraceHeader) == 20, "trace layout");
+static_assert(sizeof(TraceEntry) == 12, "trace layout");
+
+/**
+ * Module Method stubs.
+ */
+bool traceRecord(const string& path, Window root, int width, int height,
+    const Atom* atoms, int atomCount, OutputWriter& out);
+bool traceReplay(const string& path, long latencyMilliseconds,
+    OutputWriter& out);
+void traceFinish();
+
+bool isTraceReplaying();
+bool getTraceDisplay(Window* root, int* width, int* height,
+    Atom* atoms, int atomCount);
+void traceSleep();
+
+// statsWaitForReply(), recorded or replayed.
+void* traceWaitForReply(xcb_connection_t*, unsigned int sequence,
+    xcb_generic_error_t**, const char* name, Window);
@@ -0,0 +1,166 @@
+/**
+ * XCB window backend: checked requests on the snapshot's XCB
+ * connection. Nothing blocks until syncTrackedRequests(), where
+ * the first cookie checked costs the one round trip and the rest
+ * are already answered.
+ */
+
+// Std C and c++.
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+// X11.
+#include <X11/Xlib.h>
+#include <xcb/xcb.h>
+
+// Application.
+#include "xcbBackend.h"
+#include "xStats.h"
+
+
+/**
+ * Class instantiation.
+ */
+XcbBackend::XcbBackend(xDisplayHelper* displayHelper) :
+        WindowBackend(displayHelper) {
+    mConnection = displayHelper->getXcbConnection();
+    mRoot = displayHelper->getRoot();
+}
+
+const char* XcbBackend::getName() {
+    return "xcb";
+}
+
+void XcbBackend::trackRequest(const char* verb, Window window,
+        xcb_void_cookie_t cookie) {
+    mTrackedRequests.push_back({ cookie.sequence, verb, window, 0 });
+}
+
+/**
+ * Helper sends a ConfigureWindow of the stacking only, relative
+ * to a sibling unless None.
+ */
+void XcbBackend::configureStacking(const char* verb, Window window,
+        Window sibling, int stackMode) {
+    uint32_t values[2];
+    uint16_t valueMask = XCB_CONFIG_WINDOW_STACK_MODE;
+    int count = 0;
+    if (sibling != None) {
+        valueMask |= XCB_CONFIG_WINDOW_SIBLING;
+        values[count++] = sibling;
+    }
+    values[count++] = stackMode;
+
+    statsCountCall("xcb_configure_window");
+    trackRequest(verb, window, xcb_configure_window_checked(mConnection,
+        window, valueMask, values));
+}
+
+void XcbBackend::raiseWindow(const char* verb, Window window) {
+    configureStacking(verb, window, None, XCB_STACK_MODE_ABOVE);
+}
+
+void XcbBackend::lowerWindow(const char* verb, Window window) {
+    configureStacking(verb, window, None, XCB_STACK_MODE_BELOW);
+}
+
+void XcbBackend::mapWindow(const char* verb, Window window) {
+    statsCountCall("xcb_map_window");
+    trackRequest(verb, window, xcb_map_window_checked(mConnection,
+        window));
+}
+
+void XcbBackend::unmapWindow(const char* verb, Window window) {
+    statsCountCall("xcb_unmap_window");
+    trackRequest(verb, window, xcb_unmap_window_checked(mConnection,
+        window));
+}
+
+void XcbBackend::restackWindow(const char* verb, Window window,
+        Window sibling, int stackMode) {
+    configureStacking(verb, window, sibling, stackMode);
+}
+
+/**
+ * CWX, CWY, CWWidth & CWHeight are XCB's bits too; values go in
+ * bit order.
+ */
+void XcbBackend::configureWindow(const char* verb, Window window,
+        unsigned int valueMask, int x, int y, unsigned int width,
+        unsigned int height) {
+    const uint32_t fields[4] = { (uint32_t) x, (uint32_t) y, width,
+        height };
+    uint32_t values[4];
+    uint16_t xcbMask = 0;
+    int count = 0;
+    for (int bit = 0; bit < 4; bit++) {
+        if (valueMask & (1 << bit)) {
+            xcbMask |= 1 << bit;
+            values[count++] = fields[bit];
+        }
+    }
+
+    statsCountCall("xcb_configure_window");
+    trackRequest(verb, window, xcb_configure_window_checked(mConnection,
+        window, xcbMask, values));
+}
+
+/**
+ * A format 32 ClientMessage to the window manager, by way of the
+ * root Window.
+ */
+void XcbBackend::sendRootMessage(const char* verb, Window window,
+        Atom messageType, const long data[5]) {
+    xcb_client_message_event_t event;
+    memset(&event, 0, sizeof(event));
+
+    event.response_type = XCB_CLIENT_MESSAGE;
+    event.format = 32;
+    event.window = window;
+    event.type = messageType;
+    for (int i = 0; i < 5; i++) {
+        event.data.data32[i] = data[i];
+    }
+
+    statsCountCall("xcb_send_event");
+    trackRequest(verb, window, xcb_send_event_checked(mConnection, 0,
+        mRoot, XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT |
+        XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY, (const char*) &event));
+}
+
+void XcbBackend::flush() {
+    xcb_flush(mConnection);
+}
+
+/**
+ * Any reply will do; GetInputFocus is the cheapest.
+ */
+void XcbBackend::sync() {
+    xcb_generic_error_t* error = NULL;
+    free(statsWaitForReply(mConnection,
+        xcb_get_input_focus(mConnection).sequence, &error,
+        "GetInputFocus", None));
+    free(error);
+}
+
+/**
+ * Newest first: checking it waits for everything before it.
+ */
+void XcbBackend::syncTrackedRequests() {
+    statsCountRoundTrip(32);
+    for (int i = mTrackedRequests.size() - 1; i >= 0; i--) {
+        xcb_void_cookie_t cookie;
+        cookie.sequence = mTrackedRequests[i].serial;
+
+        statsCountCall("xcb_request_check");
+        xcb_generic_error_t* error = xcb_request_check(mConnection,
+            cookie);
+        if (error) {
+            mTrackedRequests[i].errorCode = error->error_code;
+            statsCountError(error->error_code);
+            free(error);
+        }
+    }
+}
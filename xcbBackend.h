@@ -0,0 +1,51 @@
+#pragma once
+
+/**
+ * XCB window backend: checked requests on the XCB connection the
+ * snapshot queries use, so actions & queries share one connection
+ * and one request order. Errors are collected from the cookies.
+ */
+
+// X11.
+#include <X11/Xlib.h>
+#include <xcb/xcb.h>
+
+// Application.
+#include "windowBackend.h"
+#include "xDisplayHelper.h"
+
+/**
+ * Class def.
+ */
+class XcbBackend : public WindowBackend {
+    public:
+        XcbBackend(xDisplayHelper*);
+
+        const char* getName();
+
+        void raiseWindow(const char* verb, Window);
+        void lowerWindow(const char* verb, Window);
+        void mapWindow(const char* verb, Window);
+        void unmapWindow(const char* verb, Window);
+        void restackWindow(const char* verb, Window, Window sibling,
+            int stackMode);
+        void configureWindow(const char* verb, Window,
+            unsigned int valueMask, int x, int y, unsigned int width,
+            unsigned int height);
+        void sendRootMessage(const char* verb, Window,
+            Atom messageType, const long data[5]);
+
+        void flush();
+        void sync();
+
+    protected:
+        void syncTrackedRequests();
+
+    private:
+        void trackRequest(const char* verb, Window, xcb_void_cookie_t);
+        void configureStacking(const char* verb, Window, Window sibling,
+            int stackMode);
+
+        xcb_connection_t* mConnection;
+        xcb_window_t mRoot;
+};
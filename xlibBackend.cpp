@@ -0,0 +1,123 @@
+/**
+ * Xlib window backend: requests on the Display connection.
+ */
+
+// Std C and c++.
+#include <cstring>
+
+using namespace std;
+
+// X11.
+#include <X11/Xlib.h>
+
+// Application.
+#include "xlibBackend.h"
+#include "xStats.h"
+
+
+/**
+ * Class instantiation.
+ */
+XlibBackend::XlibBackend(xDisplayHelper* displayHelper) :
+        WindowBackend(displayHelper) {
+    mDisplay = displayHelper->getDisplay();
+}
+
+const char* XlibBackend::getName() {
+    return "xlib";
+}
+
+/**
+ * The next request's serial is known before it is sent.
+ */
+void XlibBackend::trackRequest(const char* verb, Window window) {
+    mTrackedRequests.push_back({ NextRequest(mDisplay), verb, window, 0 });
+}
+
+void XlibBackend::raiseWindow(const char* verb, Window window) {
+    trackRequest(verb, window);
+    statsCountCall("XRaiseWindow");
+    XRaiseWindow(mDisplay, window);
+}
+
+void XlibBackend::lowerWindow(const char* verb, Window window) {
+    trackRequest(verb, window);
+    statsCountCall("XLowerWindow");
+    XLowerWindow(mDisplay, window);
+}
+
+void XlibBackend::mapWindow(const char* verb, Window window) {
+    trackRequest(verb, window);
+    statsCountCall("XMapWindow");
+    XMapWindow(mDisplay, window);
+}
+
+void XlibBackend::unmapWindow(const char* verb, Window window) {
+    trackRequest(verb, window);
+    statsCountCall("XUnmapWindow");
+    XUnmapWindow(mDisplay, window);
+}
+
+void XlibBackend::restackWindow(const char* verb, Window window,
+        Window sibling, int stackMode) {
+    XWindowChanges changes;
+    changes.sibling = sibling;
+    changes.stack_mode = stackMode;
+
+    trackRequest(verb, window);
+    statsCountCall("XConfigureWindow");
+    XConfigureWindow(mDisplay, window, CWSibling | CWStackMode,
+        &changes);
+}
+
+void XlibBackend::configureWindow(const char* verb, Window window,
+        unsigned int valueMask, int x, int y, unsigned int width,
+        unsigned int height) {
+    XWindowChanges changes;
+    changes.x = x;
+    changes.y = y;
+    changes.width = width;
+    changes.height = height;
+
+    trackRequest(verb, window);
+    statsCountCall("XConfigureWindow");
+    XConfigureWindow(mDisplay, window, valueMask &
+        (CWX | CWY | CWWidth | CWHeight), &changes);
+}
+
+/**
+ * A format 32 ClientMessage to the window manager, by way of the
+ * root Window.
+ */
+void XlibBackend::sendRootMessage(const char* verb, Window window,
+        Atom messageType, const long data[5]) {
+    XEvent event;
+    memset(&event, 0, sizeof(event));
+
+    event.xclient.type = ClientMessage;
+    event.xclient.window = window;
+    event.xclient.message_type = messageType;
+    event.xclient.format = 32;
+    for (int i = 0; i < 5; i++) {
+        event.xclient.data.l[i] = data[i];
+    }
+
+    trackRequest(verb, window);
+    statsCountCall("XSendEvent");
+    XSendEvent(mDisplay, DefaultRootWindow(mDisplay), False,
+        SubstructureRedirectMask | SubstructureNotifyMask, &event);
+}
+
+void XlibBackend::flush() {
+    XFlush(mDisplay);
+}
+
+void XlibBackend::sync() {
+    statsCountCall("XSync");
+    XSync(mDisplay, False);
+    statsCountRoundTrip(32);
+}
+
+void XlibBackend::syncTrackedRequests() {
+    sync();
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+/**
+ * Xlib window backend: requests on the Display connection.
+ * Errors reach the Xlib error handler, which passes tracked ones
+ * to recordError().
+ */
+
+// X11.
+#include <X11/Xlib.h>
+
+// Application.
+#include "windowBackend.h"
+#include "xDisplayHelper.h"
+
+/**
+ * Class def.
+ */
+class XlibBackend : public WindowBackend {
+    public:
+        XlibBackend(xDisplayHelper*);
+
+        const char* getName();
+
+        void raiseWindow(const char* verb, Window);
+        void lowerWindow(const char* verb, Window);
+        void mapWindow(const char* verb, Window);
+        void unmapWindow(const char* verb, Window);
+        void restackWindow(const char* verb, Window, Window sibling,
+            int stackMode);
+        void configureWindow(const char* verb, Window,
+            unsigned int valueMask, int x, int y, unsigned int width,
+            unsigned int height);
+        void sendRootMessage(const char* verb, Window,
+            Atom messageType, const long data[5]);
+
+        void flush();
+        void sync();
+
+    protected:
+        void syncTrackedRequests();
+
+    private:
+        void trackRequest(const char* verb, Window);
+
+        Display* mDisplay;
+};